@@ -0,0 +1,124 @@
+/*
+ * convert.cpp
+ *
+ * Converts a delimited text dataset into a binary column file (see
+ * DataFile.h), which rf --cache and ColumnFile map without parsing.
+ */
+
+#include "ColumnFile.h"
+#include "Schema.h"
+#include "TextLoader.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+int main( int argc, char ** argv )
+{
+  if ( argc < 3 )
+  {
+    cout
+      << "Usage: rf-convert <input> <output> [options]\n"
+      << "Options:\n"
+      << "  --schema=<file>      - Read the settings below from a sidecar file\n"
+      << "                         (see Schema.h); later options override it\n"
+      << "  --delimiter=<c>      - Field delimiter (default tab)\n"
+      << "  --id-column=<n>      - Field holding the row ID, or none (default 0)\n"
+      << "  --label-column=<n>   - Field holding the class label (default 1)\n"
+      << "  --columns=<n>        - Keep the label and n-1 features, ignoring the\n"
+      << "                         remaining fields (default: all of them)\n"
+      << "  --header=<0|1>       - 1 if the first line names the fields (default 0)\n"
+      << "  --positive-max=<v>   - Store labels <= v as 1 and the rest as 0, or\n"
+      << "                         none to store them as they are (default 1, as\n"
+      << "                         rf does)\n"
+      << "  --threads=<n>        - Parsing threads (default 0: one per processor)\n"
+      << "Columns are named from the header or the sidecar, or else class, f1,\n"
+      << "f2, ... as rf names them." << endl;
+    return 1;
+  }
+
+  Schema schema;
+  schema.set_id_column( 0 );
+  schema.set_label_column( 1 );
+  schema.set_label_threshold( true, 1.0 );
+  TextLoader loader;
+  loader.set_thread_count( 0 );
+  for ( int arg = 3; arg < argc; ++arg )
+  {
+    const char * value = strchr( argv[arg], '=' );
+    if ( value == null(const char) )
+    {
+      cout << "Bad option: " << argv[arg] << endl;
+      return 1;
+    }
+    string name( argv[arg], value - argv[arg] );
+    ++value;
+
+    if ( name == "--schema" )
+    {
+      if ( !schema.read( value ) )
+      {
+        cout << "Bad schema: " << value << endl;
+        return 1;
+      }
+    }
+    else if ( name == "--delimiter" )
+    {
+      schema.set_delimiter( (strcmp(value, "\\t") == 0) ? '\t' : value[0] );
+    }
+    else if ( name == "--id-column" )
+    {
+      schema.set_id_column(
+        (strcmp(value, "none") == 0) ? TextLoader::NoColumn : atoi(value) );
+    }
+    else if ( name == "--label-column" )
+    {
+      schema.set_label_column( atoi(value) );
+    }
+    else if ( name == "--columns" )
+    {
+      schema.set_column_count( atoi(value) );
+    }
+    else if ( name == "--header" )
+    {
+      schema.set_header( atoi(value) != 0 );
+    }
+    else if ( name == "--positive-max" )
+    {
+      schema.set_label_threshold( strcmp(value, "none") != 0, atof(value) );
+    }
+    else if ( name == "--threads" )
+    {
+      loader.set_thread_count( atoi(value) );
+    }
+    else
+    {
+      cout << "Bad option: " << argv[arg] << endl;
+      return 1;
+    }
+  }
+
+  schema.configure( loader );
+  if ( !loader.open( argv[1] ) )
+  {
+    cout << "Can't read " << argv[1] << endl;
+    return 1;
+  }
+
+  // Name the columns.
+  schema.infer( loader );
+  Dataset::KeyList keys;
+  schema.name_keys( keys );
+
+  if ( !ColumnFile::convert( loader, argv[2], keys, schema.source() ) )
+  {
+    cout << "Can't write " << argv[2] << endl;
+    return 1;
+  }
+  cout
+    << "Wrote " << loader.count_rows() << " rows x " << loader.column_count()
+    << " columns to " << argv[2] << endl;
+  return 0;
+}
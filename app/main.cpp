@@ -1,258 +1,1609 @@
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <fstream>
 #include <stdlib.h>
-#include <limits>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 
 #include <openmpi/mpi.h>
 //#include <mpi.h>
 #include "Comm.h"
 
+#include "ColumnFile.h"
 #include "RandomForest.h"
 #include "Dataset.h"
+#include "Schema.h"
+#include "TextLoader.h"
 
 using namespace std;
 
-namespace std
+/**
+ * Ways of getting the training rows to the processes.
+ */
+enum LoadMode
 {
-  vector<string> Tokenize(const string& str,const string& delimiters);
-}
+  MasterLoad,       ///< The master samples the rows and sends them.
+  DistributedLoad,  ///< Each process samples the file itself.
+  SharedLoad        ///< One copy of the file per node in shared memory; each
+                    ///< process samples row indices into it.
+};
+
+/**
+ * Ways of splitting the growing between the processes.
+ */
+enum GrowMode
+{
+  TreeParallel,     ///< Each process grows whole trees from its own sample.
+  DataParallel      ///< Each process holds a shard of the rows and all of them
+                    ///< grow every tree together.
+};
+
+/**
+ * Ways of scoring the test set.
+ */
+enum ScoreMode
+{
+  MasterScore,      ///< The master scores every row.
+  DistributedScore  ///< The rows are scattered and every process scores some.
+};
+
+/**
+ * Cells of the test set confusion matrix.
+ */
+enum ConfusionCell
+{
+  TruePositive,
+  FalsePositive,
+  TrueNegative,
+  FalseNegative,
+  ConfusionCells
+};
 
-void execute_main( const int process_count, const double sample_probability  );
+/**
+ * Optional settings, given as --name=value after the positional arguments.
+ */
+struct Options
+{
+  unsigned int histogram_bins;  ///< Quantile bins per feature, 0 for exact splits.
+  unsigned int threads;         ///< Worker threads, 0 for one per processor.
+  unsigned long seed;           ///< Forest seed.
+  string model;                 ///< Flat model file to write, if any.
+  string score_model;           ///< Flat model file to score with instead of growing, if any.
+  string checkpoint;            ///< Directory for child tree checkpoints, if any.
+  unsigned int send_buffer;     ///< Row batch size per child, in MB.
+  LoadMode load;                ///< How the processes get their rows.
+  unsigned int tree_batch;      ///< Trees handed out at a time.
+  GrowMode grow;                ///< How the processes share the growing.
+  ScoreMode score;              ///< How the processes share the scoring.
+  string cache;                 ///< Directory for column file copies of the data, if any.
+  Dataset::Storage storage;     ///< How the training rows are stored.
+  unsigned int storage_codes;   ///< Codes per column, for coded storage.
+};
+
+/**
+ * Double-buffered rows on their way to one child. One buffer fills while the
+ * other is being sent.
+ */
+struct RowStream
+{
+  vector<double> buffers[2];    ///< Row batches.
+  vector<float> packed[2];      ///< Row batches sent as floats.
+  MPI_Request requests[2];      ///< Send in progress per buffer.
+  unsigned int current;         ///< Buffer being filled.
+  unsigned int rows;            ///< Rows in the current buffer.
+};
+
+/**
+ * A dataset file: the text file or, with --cache, a column file converted from
+ * it on first use.
+ */
+struct DataSource
+{
+  TextLoader text;              ///< The text file.
+  ColumnFile columns;           ///< The column file, if cached.
+  RowReader * reader;           ///< Whichever of the two is open.
+};
+
+/**
+ * A process's training rows: the rows it loaded, or a shared copy of the whole
+ * file, plus the rows of that matrix in its sample.
+ */
+struct TrainingSet
+{
+  vector<double> data;          ///< Rows loaded by this process.
+  double * matrix;              ///< The rows to train from.
+  unsigned int matrix_rows;     ///< Rows in the matrix.
+  Dataset::Layout layout;       ///< Layout of the matrix.
+  bool mapped;                  ///< Whether the matrix is the mapped column file.
+  DataSource source;            ///< Mapped column file, if trained from the cache.
+  vector<unsigned int> sample;  ///< Sampled rows of the matrix.
+  MPI_Comm node_comm;           ///< Processes sharing the matrix, if shared.
+  MPI_Win window;               ///< Shared matrix window, if shared.
+};
+
+/**
+ * Batches of tree indices, handed out to the slaves and to the master's own
+ * growing thread.
+ */
+class TreeQueue
+{
+  public:
+    /**
+     * Constructor.
+     * @param tree_total The number of trees to grow.
+     * @param tree_batch The number of trees per batch.
+     */
+    TreeQueue( const unsigned int tree_total, const unsigned int tree_batch ) :
+      next_tree(0),
+      tree_total(tree_total),
+      tree_batch(tree_batch)
+    {
+      pthread_mutex_init(&mutex, NULL);
+    }
+
+    /**
+     * Destructor.
+     */
+    ~TreeQueue( void )
+    {
+      pthread_mutex_destroy(&mutex);
+    }
+
+    /**
+     * Take the next batch.
+     * @param [out] first_tree The index of the first tree.
+     * @param [out] count The number of trees, 0 once all are handed out.
+     * @return True if a batch was taken.
+     */
+    bool take( unsigned int & first_tree, unsigned int & count )
+    {
+      pthread_mutex_lock(&mutex);
+      first_tree = next_tree;
+      count = min( tree_batch, tree_total - next_tree );
+      next_tree += count;
+      pthread_mutex_unlock(&mutex);
+      return count > 0;
+    }
+
+  private:
+    pthread_mutex_t mutex;    ///< Access mutex.
+    unsigned int next_tree;   ///< First tree not handed out.
+    unsigned int tree_total;  ///< Trees to grow.
+    unsigned int tree_batch;  ///< Trees per batch.
+};
+
+/**
+ * The master's own tree growing, run on a thread beside its communication.
+ */
+struct MasterGrower
+{
+  TreeQueue * queue;                      ///< Batches to take from.
+  Dataset * dataset;                      ///< The master's training sample.
+  const Dataset::KeyList * split_keys;    ///< Keys to split on.
+  unsigned int bootstrap_size;            ///< Bootstrap sample size.
+  unsigned int keys_per_node;             ///< Keys compared per node.
+  const Options * options;                ///< Settings.
+  RandomForest forest;                    ///< The trees grown.
+  double busy;                            ///< Seconds spent growing.
+};
+
+/**
+ * Sums tree growing histograms over the processes of a communicator.
+ */
+class MpiHistogramReducer : public HistogramReducer
+{
+  public:
+    /**
+     * Constructor.
+     * @param comm The processes growing the trees together.
+     */
+    MpiHistogramReducer( MPI_Comm comm ) :
+      comm(comm)
+    {
+      //
+    }
+
+    virtual void sum( vector<unsigned int> & counts )
+    {
+      MPI_Allreduce(
+        MPI_IN_PLACE, &counts[0], counts.size(), MPI_UNSIGNED, MPI_SUM, comm );
+    }
+
+    virtual void gather( vector<double> & values )
+    {
+      int process_count = 0;
+      MPI_Comm_size( comm, &process_count );
+      int size = values.size();
+      vector<int> sizes( process_count );
+      MPI_Allgather( &size, 1, MPI_INT, &sizes[0], 1, MPI_INT, comm );
+      vector<int> offsets( process_count, 0 );
+      for ( int process = 1; process < process_count; ++process )
+      {
+        offsets[process] = offsets[process - 1] + sizes[process - 1];
+      }
+      vector<double> gathered( offsets.back() + sizes.back() );
+      MPI_Allgatherv(
+        values.empty() ? null(double) : &values[0], size, MPI_DOUBLE,
+        gathered.empty() ? null(double) : &gathered[0], &sizes[0], &offsets[0],
+        MPI_DOUBLE, comm );
+      values.swap( gathered );
+    }
+
+  private:
+    MPI_Comm comm;  ///< Processes growing the trees.
+};
+
+/**
+ * Random stream index for training set sampling. Trees use the indices from 0
+ * up in the same stream.
+ */
+const uint64_t SampleStreamIndex = 0xFFFFFFFFFFFFFFFFull;
+
+/**
+ * Rows passed at a time by the master as it samples for every process. The
+ * kept rows of each block are parsed by all the threads.
+ */
+const unsigned int LoadBlockRows = 8192;
+
+/**
+ * Serializes console output from the master's communication and growing
+ * threads.
+ */
+pthread_mutex_t console_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+bool parse_options( const int argc, char ** argv, Options & options );
+
+bool load_schema(
+  const unsigned int rank,
+  const unsigned int master_rank,
+  const string & name,
+  const Options & options,
+  Schema & schema );
+
+bool open_data(
+  DataSource & source,
+  const string & name,
+  const Schema & schema,
+  const Options & options );
+
+double seconds( void );
+
+void send_rows(
+  RowStream & stream,
+  const unsigned int child_rank,
+  const unsigned int col_count,
+  const Dataset::Storage storage );
+
+void distribute_rows(
+  const unsigned int child_process_count,
+  const unsigned int rank,
+  const double sample_probability,
+  const Options & options,
+  const Schema & schema,
+  vector<double> & own_rows );
+
+void load_shard(
+  const unsigned int rank,
+  const double sample_probability,
+  const Options & options,
+  const Schema & schema,
+  TrainingSet & training );
+
+void load_partition(
+  const unsigned int rank,
+  const unsigned int process_count,
+  const double sample_probability,
+  const Options & options,
+  const Schema & schema,
+  vector<double> & data );
+
+void read_kept(
+  RowReader & reader,
+  const vector<bool> & keep,
+  const unsigned int col_count,
+  vector<double> & data );
+
+void receive_rows(
+  const unsigned int parent_rank,
+  const unsigned int rank,
+  const unsigned int col_count,
+  const Dataset::Storage storage,
+  vector<double> & data );
+
+void load_shared(
+  const unsigned int rank,
+  const double sample_probability,
+  const Options & options,
+  const Schema & schema,
+  TrainingSet & training );
+
+void sample_rows(
+  const unsigned int rank,
+  const double sample_probability,
+  const Options & options,
+  TrainingSet & training );
+
+void index_rows( TrainingSet & training, const unsigned int col_count );
+
+Dataset::RealMatrix * training_matrix(
+  TrainingSet & training,
+  const unsigned int col_count,
+  const Options & options );
+
+void release_training_set( TrainingSet & training );
+
+void configure_keys(
+  Dataset & dataset,
+  Dataset::KeyList & split_keys,
+  const Schema & schema );
+
+void write_checkpoint(
+  const Options & options,
+  const unsigned int first_tree,
+  const string & tree_buffer );
+
+void * grow_master_trees( void * grower_pointer );
+
+void report( const string & line );
+
+void save_model( RandomForest & forest, const Options & options );
+
+void load_test_rows(
+  vector<double> & data,
+  unsigned int & col_count,
+  const Schema & schema,
+  const Options & options );
+
+void count_confusion(
+  const RandomForest & forest,
+  double * const rows,
+  const unsigned int row_count,
+  const unsigned int col_count,
+  unsigned int confusion[ConfusionCells] );
+
+void report_confusion( const unsigned int confusion[ConfusionCells] );
+
+void test_forest(
+  RandomForest & forest,
+  const Schema & schema,
+  const Options & options );
+
+void test_forest_distributed(
+  RandomForest & forest,
+  const unsigned int rank,
+  const int process_count,
+  const bool forest_shared,
+  const Schema & schema,
+  const Options & options );
+
+void execute_main(
+  const int process_count,
+  const unsigned int bootstrap_divisor,
+  const unsigned int split_keys_per_node,
+  const unsigned int trees_per_forest,
+  const double sample_probability,
+  const Schema & schema,
+  const Options & options,
+  const bool threaded );
 
 void execute_child(
   const unsigned int parent_rank,
   const unsigned int rank,
   const unsigned int bootstrap_divisor,
   const unsigned int split_keys_per_node,
-  const unsigned int trees_per_forest );
+  const unsigned int trees_per_forest,
+  const double sample_probability,
+  const Schema & schema,
+  const Options & options );
+
+void execute_data_parallel(
+  const unsigned int rank,
+  const int process_count,
+  const unsigned int bootstrap_divisor,
+  const unsigned int split_keys_per_node,
+  const unsigned int trees_per_forest,
+  const double sample_probability,
+  const Schema & schema,
+  const Options & options );
+
+void execute_scoring(
+  const unsigned int rank,
+  const int process_count,
+  const Schema & schema,
+  const Options & options );
+
+int main( int argc, char ** argv )
+{
+  int is_initialized = 0;
+
+  // Determine if MPI has been initialized already.
+  MPI_Initialized(&is_initialized);
+  if (!is_initialized)
+  {
+    // Initialize MPI. Only the main thread makes MPI calls; the others grow
+    // trees.
+    int thread_support = 0;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support);
+
+    // Determine if this it the master process or a child.
+    int rank = 0;
+    int processes = 0;
+    char name[MPI_MAX_PROCESSOR_NAME];
+    int name_size = 0;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &processes);
+    MPI_Get_processor_name(name, &name_size);
+    cout
+      << "Spawned [ P: " << processes << " R: "
+      << rank << " N: " << name << endl;
+
+    // Enough arguments?
+    Options options;
+    if ( (argc < 5) || !parse_options(argc, argv, options) )
+    {
+      if ( rank == 0 )
+      {
+        cout
+          << "Usage: mpirun -n <1> rf <2> <3> <4> <5>\n"
+          << "  <1> - Number of nodes to use\n"
+          << "  <2> - Bootstrap divisor\n"
+          << "  <3> - Split keys per node\n"
+          << "  <4> - Trees per forest, per process\n"
+          << "  <5> - Training set sample probability (%)\n"
+          << "Options:\n"
+          << "  --histogram-bins=<n> - Quantile bins per feature, at most 256\n"
+          << "                         (default 0: exact split finding)\n"
+          << "  --threads=<n>        - Parsing, growing and scoring threads per process\n"
+          << "                         (default 0: one per processor)\n"
+          << "  --seed=<n>           - Forest random seed (default 0). Tree t draws the\n"
+          << "                         same numbers on any process, but with --grow=trees\n"
+          << "                         it is grown from the sample of whichever process\n"
+          << "                         takes it, so runs only repeat at 100% sampling\n"
+          << "  --model=<path>       - Write the forest as a flat model file\n"
+          << "  --score-model=<path> - Map a flat model file and score the test set with\n"
+          << "                         it instead of growing a forest (--score applies)\n"
+          << "  --checkpoint=<dir>   - Also write each batch of trees to <dir>/trees_<first>.tree\n"
+          << "  --send-buffer=<MB>   - Row batch size per slave (default 4)\n"
+          << "  --load=<mode>        - master: the master sends the rows (default)\n"
+          << "                         distributed: each process samples the file itself\n"
+          << "                         shared: one copy per node, shared by its processes\n"
+          << "  --tree-batch=<n>     - Trees handed out at a time (default 10)\n"
+          << "  --grow=<mode>        - trees: each process grows whole trees (default)\n"
+          << "                         data-parallel: each process loads a shard of the\n"
+          << "                         rows and all of them grow every tree together\n"
+          << "                         (histogram splits; --load is ignored)\n"
+          << "  --score=<mode>       - master: the master scores the test set (default)\n"
+          << "                         distributed: the test rows are scattered and\n"
+          << "                         every process scores its share\n"
+          << "  --cache=<dir>        - Keep binary column copies of the data files in <dir>,\n"
+          << "                         converting them on first use, and map them instead\n"
+          << "                         of parsing the text\n"
+          << "  --storage=<mode>     - double: train from the rows as loaded (default)\n"
+          << "                         float: from a float copy of the sample, which is\n"
+          << "                         also sent as floats with --load=master\n"
+          << "                         codes: from a copy coded per column in 8 or 16 bits\n"
+          << "  --storage-codes=<n>  - Codes per column for --storage=codes, at most 65536;\n"
+          << "                         columns with more values are quantized (default 65536)\n"
+          << "The layout of the data is read from data/seq_val_1_2.schema, if there is\n"
+          << "one (see Schema.h), and otherwise taken from the data." << endl;
+      }
+    }
+    else
+    {
+      double sample_probability = atof(argv[4]);
+      if ( sample_probability < 1.0 )
+      {
+        sample_probability = 1.0;
+      }
+      if ( sample_probability > 100.0 )
+      {
+        sample_probability = 100.0;
+      }
+
+      // Extract parameters.
+      unsigned int bootstrap_divisor = atoi(argv[1]);
+      unsigned int split_keys_per_node = atoi(argv[2]);
+      unsigned int trees_per_forest = atoi(argv[3]);
+
+      // The master reads the layout of the training data for everyone.
+      Schema schema;
+      if ( !load_schema( rank, processes - 1, "seq_val_1_2", options, schema ) )
+      {
+        if ( rank == processes - 1 )
+        {
+          cerr << "Master: Can't determine the layout of the training data." << endl;
+        }
+      }
+      else if ( !options.score_model.empty() )
+      {
+        execute_scoring( rank, processes, schema, options );
+      }
+      else if ( options.grow == DataParallel )
+      {
+        execute_data_parallel(
+          rank,
+          processes,
+          bootstrap_divisor,
+          split_keys_per_node,
+          trees_per_forest,
+          sample_probability / 100.0,
+          schema,
+          options );
+      }
+      else if (rank == processes-1)
+      {
+        execute_main(
+          processes,
+          bootstrap_divisor,
+          split_keys_per_node,
+          trees_per_forest,
+          sample_probability / 100.0,
+          schema,
+          options,
+          thread_support >= MPI_THREAD_FUNNELED );
+      }
+      else
+      {
+        execute_child(
+          processes-1,
+          rank,
+          bootstrap_divisor,
+          split_keys_per_node,
+          trees_per_forest,
+          sample_probability / 100.0,
+          schema,
+          options );
+      }
+    }
+  }
+
+  // Finalize MPI.
+  MPI_Finalize();
+
+  return 0;
+}
+
+bool parse_options( const int argc, char ** argv, Options & options )
+{
+  // Defaults.
+  options.histogram_bins = 0;
+  options.threads = 0;
+  options.seed = 0;
+  options.model.clear();
+  options.score_model.clear();
+  options.checkpoint.clear();
+  options.send_buffer = 4;
+  options.load = MasterLoad;
+  options.tree_batch = 10;
+  options.grow = TreeParallel;
+  options.score = MasterScore;
+  options.cache.clear();
+  options.storage = Dataset::DoubleStorage;
+  options.storage_codes = Dataset::RealMatrix::MaxCodes;
+
+  for ( int arg = 5; arg < argc; ++arg )
+  {
+    const char * value = strchr( argv[arg], '=' );
+    if ( value == null(const char) )
+    {
+      return false;
+    }
+    string name( argv[arg], value - argv[arg] );
+    ++value;
+
+    if ( name == "--histogram-bins" )
+    {
+      options.histogram_bins = atoi(value);
+    }
+    else if ( name == "--threads" )
+    {
+      options.threads = atoi(value);
+    }
+    else if ( name == "--seed" )
+    {
+      options.seed = strtoul(value, null(char*), 10);
+    }
+    else if ( name == "--model" )
+    {
+      options.model = value;
+    }
+    else if ( name == "--score-model" )
+    {
+      options.score_model = value;
+    }
+    else if ( name == "--checkpoint" )
+    {
+      options.checkpoint = value;
+    }
+    else if ( name == "--send-buffer" )
+    {
+      options.send_buffer = atoi(value);
+    }
+    else if ( (name == "--load") && (strcmp(value, "master") == 0) )
+    {
+      options.load = MasterLoad;
+    }
+    else if ( (name == "--load") && (strcmp(value, "distributed") == 0) )
+    {
+      options.load = DistributedLoad;
+    }
+    else if ( (name == "--load") && (strcmp(value, "shared") == 0) )
+    {
+      options.load = SharedLoad;
+    }
+    else if ( name == "--tree-batch" )
+    {
+      options.tree_batch = atoi(value);
+    }
+    else if ( (name == "--grow") && (strcmp(value, "trees") == 0) )
+    {
+      options.grow = TreeParallel;
+    }
+    else if ( (name == "--grow") && (strcmp(value, "data-parallel") == 0) )
+    {
+      options.grow = DataParallel;
+    }
+    else if ( (name == "--score") && (strcmp(value, "master") == 0) )
+    {
+      options.score = MasterScore;
+    }
+    else if ( (name == "--score") && (strcmp(value, "distributed") == 0) )
+    {
+      options.score = DistributedScore;
+    }
+    else if ( name == "--cache" )
+    {
+      options.cache = value;
+    }
+    else if ( (name == "--storage") && (strcmp(value, "double") == 0) )
+    {
+      options.storage = Dataset::DoubleStorage;
+    }
+    else if ( (name == "--storage") && (strcmp(value, "float") == 0) )
+    {
+      options.storage = Dataset::FloatStorage;
+    }
+    else if ( (name == "--storage") && (strcmp(value, "codes") == 0) )
+    {
+      options.storage = Dataset::CodeStorage;
+    }
+    else if ( name == "--storage-codes" )
+    {
+      options.storage_codes = atoi(value);
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+double seconds( void )
+{
+  timeval time;
+  gettimeofday( &time, NULL );
+  return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+void send_rows(
+  RowStream & stream,
+  const unsigned int child_rank,
+  const unsigned int col_count,
+  const Dataset::Storage storage )
+{
+  if ( stream.rows == 0 )
+  {
+    return;
+  }
+
+  // Start sending the current buffer. Children that store floats are sent
+  // floats, half the bytes.
+  if ( storage == Dataset::FloatStorage )
+  {
+    const vector<double> & rows = stream.buffers[stream.current];
+    vector<float> & packed = stream.packed[stream.current];
+    packed.assign( rows.begin(), rows.begin() + stream.rows * col_count );
+    MPI_Isend(
+      &packed[0],
+      packed.size(),
+      MPI_FLOAT,
+      child_rank,
+      MessageTag::RowBuffer,
+      MPI_COMM_WORLD,
+      &stream.requests[stream.current] );
+  }
+  else
+  {
+    MPI_Isend(
+      &stream.buffers[stream.current][0],
+      stream.rows * col_count,
+      MPI_DOUBLE,
+      child_rank,
+      MessageTag::RowBuffer,
+      MPI_COMM_WORLD,
+      &stream.requests[stream.current] );
+  }
+  stream.rows = 0;
+
+  // Switch buffers, waiting for the other one's last send to finish.
+  stream.current = 1 - stream.current;
+  MPI_Wait( &stream.requests[stream.current], MPI_STATUS_IGNORE );
+}
+
+bool load_schema(
+  const unsigned int rank,
+  const unsigned int master_rank,
+  const string & name,
+  const Options & options,
+  Schema & schema )
+{
+  // The master starts from the sidecar, if there is one, and fills in the rest
+  // from the data. First element is the ID. Second element is the class:
+  // 1 - somatic, 2 - germline, 3 - wildtype, of which somatic is positive.
+  string schema_text;
+  if ( rank == master_rank )
+  {
+    schema.set_id_column( 0 );
+    schema.set_label_column( 1 );
+    schema.set_label_threshold( true, 1.0 );
+    string schema_file = "data/" + name + ".schema";
+    struct stat schema_status;
+    if ( (stat(schema_file.c_str(), &schema_status) == 0) && !schema.read( schema_file ) )
+    {
+      cerr << "Master: Bad schema " << schema_file << endl;
+    }
+    else
+    {
+      DataSource source;
+      if ( open_data( source, name, schema, options ) )
+      {
+        if ( source.reader == &source.columns )
+        {
+          schema.infer( source.columns );
+        }
+        else
+        {
+          schema.infer( source.text );
+        }
+      }
+      ostringstream schema_out;
+      schema.write( schema_out );
+      schema_text = schema_out.str();
+    }
+  }
+
+  // Send it to everyone else.
+  unsigned long size = schema_text.size();
+  MPI_Bcast( &size, 1, MPI_UNSIGNED_LONG, master_rank, MPI_COMM_WORLD );
+  schema_text.resize( size );
+  MPI_Bcast( &schema_text[0], size, MPI_BYTE, master_rank, MPI_COMM_WORLD );
+  if ( rank != master_rank )
+  {
+    istringstream schema_in( schema_text );
+    schema.read( schema_in );
+  }
+
+  // Names are only filled in once the data has been read.
+  return !schema.get_names().empty();
+}
+
+bool open_data(
+  DataSource & source,
+  const string & name,
+  const Schema & schema,
+  const Options & options )
+{
+  // Columns past the schema's column count (if not 0) are ignored.
+  schema.configure( source.text );
+  source.text.set_thread_count( options.threads );
+  source.reader = &source.text;
+  string text_file = "data/" + name + ".csv";
+  if ( options.cache.empty() )
+  {
+    return source.text.open( text_file );
+  }
+
+  // Map the column file, converting the text first if there's no copy, the
+  // text is newer or the copy was parsed with other settings or columns.
+  string column_file = options.cache + "/" + name + ".rfd";
+  struct stat text_status;
+  struct stat column_status;
+  bool current =
+    ( stat(column_file.c_str(), &column_status) == 0 ) &&
+    ( (stat(text_file.c_str(), &text_status) != 0) ||
+      (text_status.st_mtime <= column_status.st_mtime) );
+  if ( !current || !source.columns.open( column_file ) || !schema.matches( source.columns ) )
+  {
+    if ( !source.text.open( text_file ) )
+    {
+      return false;
+    }
+    Schema file_schema = schema;
+    file_schema.infer( source.text );
+    Dataset::KeyList keys;
+    file_schema.name_keys( keys );
+    if ( !ColumnFile::convert( source.text, column_file, keys, schema.source() ) ||
+         !source.columns.open( column_file ) )
+    {
+      // Keep reading the text.
+      source.text.rewind();
+      return true;
+    }
+    source.text.close();
+  }
+  source.reader = &source.columns;
+  return true;
+}
+
+void distribute_rows(
+  const unsigned int child_process_count,
+  const unsigned int rank,
+  const double sample_probability,
+  const Options & options,
+  const Schema & schema,
+  vector<double> & own_rows )
+{
+  // The master keeps a sample of its own and draws each child's from that
+  // child's stream, so every rank gets the rows load_shard() would give it.
+  RandomStream random( options.seed, rank, SampleStreamIndex );
+  vector<RandomStream> child_random;
+  for ( unsigned int child_rank = 0; child_rank < child_process_count; ++child_rank )
+  {
+    child_random.push_back( RandomStream( options.seed, child_rank, SampleStreamIndex ) );
+  }
+
+  // Read data.
+  unsigned int col_count = schema.column_count();
+
+  // Buffers.
+  Dataset::RealMatrix block( LoadBlockRows, col_count );
+
+  // Batch the rows for each child.
+  unsigned int element_size =
+    ( options.storage == Dataset::FloatStorage ) ? sizeof(float) : sizeof(double);
+  unsigned int batch_rows = options.send_buffer * 1024 * 1024 / (col_count * element_size);
+  if ( batch_rows == 0 )
+  {
+    batch_rows = 1;
+  }
+  vector<RowStream> streams( child_process_count );
+  for ( unsigned int child_rank = 0; child_rank < child_process_count; ++child_rank )
+  {
+    RowStream & stream = streams[child_rank];
+    for ( unsigned int buffer = 0; buffer < 2; ++buffer )
+    {
+      stream.buffers[buffer].resize( batch_rows * col_count );
+      stream.requests[buffer] = MPI_REQUEST_NULL;
+    }
+    stream.current = 0;
+    stream.rows = 0;
+  }
+
+  cout << "Master: Loading data..." << endl;
+  DataSource source;
+  open_data( source, "seq_val_1_2", schema, options );
+
+  // Draw for every row of the file first, so only the rows someone keeps are
+  // parsed and everyone's rows can be sized once.
+  unsigned long row_count = source.reader->count_rows();
+  vector<bool> own_keep( row_count );
+  vector< vector<bool> > child_keep( child_process_count, vector<bool>( row_count ) );
+  vector<bool> keep( row_count );
+  vector<unsigned long> child_rows( child_process_count, 0 );
+  unsigned long own_count = 0;
+  for ( unsigned long line = 0; line < row_count; ++line )
+  {
+    own_keep[line] = random.uniform_real() < sample_probability;
+    own_count += own_keep[line] ? 1 : 0;
+    keep[line] = own_keep[line];
+    for ( unsigned int child_rank = 0; child_rank < child_process_count; ++child_rank )
+    {
+      child_keep[child_rank][line] =
+        child_random[child_rank].uniform_real() < sample_probability;
+      child_rows[child_rank] += child_keep[child_rank][line] ? 1 : 0;
+      keep[line] = keep[line] || child_keep[child_rank][line];
+    }
+  }
+  for ( unsigned int child_rank = 0; child_rank < child_process_count; ++child_rank )
+  {
+    MPI_Send(
+      &child_rows[child_rank],
+      1,
+      MPI_UNSIGNED_LONG,
+      child_rank,
+      MessageTag::RowCount,
+      MPI_COMM_WORLD );
+  }
+  own_rows.resize( own_count * col_count );
+
+  vector<bool> block_keep;
+  size_t own_offset = 0;
+  for ( unsigned long first_line = 0; first_line < row_count; first_line += LoadBlockRows )
+  {
+    unsigned long end_line = min( first_line + LoadBlockRows, row_count );
+    block_keep.assign( keep.begin() + first_line, keep.begin() + end_line );
+    source.reader->read_selected( block, block_keep );
+    unsigned int block_row = 0;
+    for ( unsigned long line = first_line; line < end_line; ++line )
+    {
+      if ( !keep[line] )
+      {
+        continue;
+      }
+      const double * row_buffer = block[block_row++];
+      if ( own_keep[line] )
+      {
+        copy( row_buffer, row_buffer + col_count, own_rows.begin() + own_offset );
+        own_offset += col_count;
+      }
+
+      // Send to child.
+      for ( unsigned int child_rank = 0; child_rank < child_process_count; ++child_rank )
+      {
+        if ( child_keep[child_rank][line] )
+        {
+          RowStream & stream = streams[child_rank];
+          copy(
+            row_buffer, row_buffer + col_count,
+            stream.buffers[stream.current].begin() + stream.rows * col_count );
+          if ( ++stream.rows == batch_rows )
+          {
+            send_rows( stream, child_rank, col_count, options.storage );
+          }
+        }
+      }
+    }
+  }
+
+  // Send what's left.
+  cout << "Master: Loading finished. Sending the last rows to children..." << endl;
+  for ( unsigned int child_rank = 0; child_rank < child_process_count; ++child_rank )
+  {
+    RowStream & stream = streams[child_rank];
+    send_rows( stream, child_rank, col_count, options.storage );
+    MPI_Waitall( 2, stream.requests, MPI_STATUSES_IGNORE );
+  }
+}
+
+void load_shard(
+  const unsigned int rank,
+  const double sample_probability,
+  const Options & options,
+  const Schema & schema,
+  TrainingSet & training )
+{
+  // Train straight from a mapped column file, sampling row indices into it, so
+  // only the pages of the columns examined are read and the file can be
+  // larger than memory.
+  DataSource & source = training.source;
+  open_data( source, "seq_val_1_2", schema, options );
+  if ( source.reader == &source.columns )
+  {
+    Dataset::RealMatrix & matrix = source.columns.get_matrix();
+    training.matrix = matrix.column_data( 0 );
+    training.matrix_rows = matrix.row_count();
+    training.layout = Dataset::ColumnMajor;
+    training.mapped = true;
+    sample_rows( rank, sample_probability, options, training );
+    return;
+  }
+
+  // Each rank samples the rows from its own stream, so the shards are
+  // independent, as when the master samples them. Rows that aren't kept are
+  // never parsed.
+  RandomStream random( options.seed, rank, SampleStreamIndex );
+  unsigned int col_count = schema.column_count();
+  vector<bool> keep( source.reader->count_rows() );
+  for ( unsigned long line = 0; line < keep.size(); ++line )
+  {
+    keep[line] = random.uniform_real() < sample_probability;
+  }
+  read_kept( *source.reader, keep, col_count, training.data );
+  source.text.close();
+  index_rows( training, col_count );
+}
+
+void load_partition(
+  const unsigned int rank,
+  const unsigned int process_count,
+  const double sample_probability,
+  const Options & options,
+  const Schema & schema,
+  vector<double> & data )
+{
+  // Every process takes every process_count-th row, so the partitions are
+  // disjoint, and samples it from its own stream. Other rows aren't parsed.
+  RandomStream random( options.seed, rank, SampleStreamIndex );
+  unsigned int col_count = schema.column_count();
+  DataSource source;
+  open_data( source, "seq_val_1_2", schema, options );
+  vector<bool> keep( source.reader->count_rows() );
+  for ( unsigned long line = 0; line < keep.size(); ++line )
+  {
+    keep[line] =
+      ((line % process_count) == rank) &&
+      (random.uniform_real() < sample_probability);
+  }
+  read_kept( *source.reader, keep, col_count, data );
+}
+
+void read_kept(
+  RowReader & reader,
+  const vector<bool> & keep,
+  const unsigned int col_count,
+  vector<double> & data )
+{
+  // Size the rows once from the draws, and parse the kept ones straight into
+  // them.
+  unsigned long kept = count( keep.begin(), keep.end(), true );
+  data.resize( kept * col_count );
+  if ( kept > 0 )
+  {
+    Dataset::RealMatrix matrix( &data[0], kept, col_count );
+    reader.read_selected( matrix, keep );
+  }
+}
+
+void receive_rows(
+  const unsigned int parent_rank,
+  const unsigned int rank,
+  const unsigned int col_count,
+  const Dataset::Storage storage,
+  vector<double> & data )
+{
+  // The row count comes first, so the rows are sized once.
+  MPI_Status status;
+  unsigned long total_rows = 0;
+  MPI_Recv(
+    &total_rows,
+    1,
+    MPI_UNSIGNED_LONG,
+    parent_rank,
+    MessageTag::RowCount,
+    MPI_COMM_WORLD,
+    &status );
+  data.resize( total_rows * col_count );
+
+  // Float batches are widened into place, and double batches received
+  // straight into it.
+  vector<float> packed;
+  size_t offset = 0;
+  while ( offset < data.size() )
+  {
+    MPI_Probe( parent_rank, MessageTag::RowBuffer, MPI_COMM_WORLD, &status );
+    int count = 0;
+    MPI_Get_count(
+      &status, (storage == Dataset::FloatStorage) ? MPI_FLOAT : MPI_DOUBLE, &count );
+    if ( offset + count > data.size() )
+    {
+      cerr << "Slave " << rank << ": Expected " << total_rows << " rows, received more" << endl;
+      data.resize( offset );
+      break;
+    }
+    if ( storage == Dataset::FloatStorage )
+    {
+      packed.resize( count );
+      MPI_Recv(
+        &packed[0],
+        count,
+        MPI_FLOAT,
+        parent_rank,
+        MessageTag::RowBuffer,
+        MPI_COMM_WORLD,
+        &status );
+      copy( packed.begin(), packed.end(), data.begin() + offset );
+    }
+    else
+    {
+      MPI_Recv(
+        &data[offset],
+        count,
+        MPI_DOUBLE,
+        parent_rank,
+        MessageTag::RowBuffer,
+        MPI_COMM_WORLD,
+        &status );
+    }
+    offset += count;
+  }
+}
+
+void load_shared(
+  const unsigned int rank,
+  const double sample_probability,
+  const Options & options,
+  const Schema & schema,
+  TrainingSet & training )
+{
+  unsigned int col_count = schema.column_count();
+
+  // Group the processes by node.
+  MPI_Comm_split_type(
+    MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &training.node_comm );
+  int node_rank = 0;
+  MPI_Comm_rank( training.node_comm, &node_rank );
+
+  // With a cache, the leader converts the file if needed and then every
+  // process maps the column file. The page cache holds one copy per node.
+  DataSource & source = training.source;
+  int mapped = 0;
+  if ( node_rank == 0 )
+  {
+    open_data( source, "seq_val_1_2", schema, options );
+    mapped = ( source.reader == &source.columns );
+  }
+  MPI_Bcast( &mapped, 1, MPI_INT, 0, training.node_comm );
+  if ( mapped && (node_rank != 0) )
+  {
+    open_data( source, "seq_val_1_2", schema, options );
+  }
+  unsigned long rows = ( node_rank == 0 ) ? source.reader->count_rows() : 0;
+  MPI_Bcast( &rows, 1, MPI_UNSIGNED_LONG, 0, training.node_comm );
+  training.matrix_rows = rows;
+  training.mapped = ( mapped != 0 );
+  if ( mapped )
+  {
+    training.matrix = source.columns.get_matrix().column_data( 0 );
+    training.layout = Dataset::ColumnMajor;
+  }
+  else
+  {
+    // The leader's part of the window holds the whole matrix.
+    MPI_Aint size = ( node_rank == 0 ) ? rows * col_count * sizeof(double) : 0;
+    double * data = null(double);
+    MPI_Win_allocate_shared(
+      size, sizeof(double), MPI_INFO_NULL, training.node_comm, &data, &training.window );
+    if ( node_rank != 0 )
+    {
+      int displacement_unit = 0;
+      MPI_Win_shared_query( training.window, 0, &size, &displacement_unit, &data );
+    }
+    training.matrix = data;
+    training.layout = Dataset::RowMajor;
+
+    // The leader fills it.
+    MPI_Win_fence( 0, training.window );
+    if ( node_rank == 0 )
+    {
+      Dataset::RealMatrix matrix( data, rows, col_count );
+      source.reader->read( matrix );
+    }
+    MPI_Win_fence( 0, training.window );
+  }
+  sample_rows( rank, sample_probability, options, training );
+}
+
+void sample_rows(
+  const unsigned int rank,
+  const double sample_probability,
+  const Options & options,
+  TrainingSet & training )
+{
+  // Sample row indices, drawing as load_shard() does when it copies the rows.
+  RandomStream random( options.seed, rank, SampleStreamIndex );
+  for ( unsigned int row = 0; row < training.matrix_rows; ++row )
+  {
+    if ( random.uniform_real() < sample_probability )
+    {
+      training.sample.push_back( row );
+    }
+  }
+}
+
+void index_rows( TrainingSet & training, const unsigned int col_count )
+{
+  // Train from every loaded row.
+  training.matrix = &training.data[0];
+  training.matrix_rows = training.data.size() / col_count;
+  training.layout = Dataset::RowMajor;
+  training.mapped = false;
+  training.sample.resize( training.matrix_rows );
+  for ( unsigned int row = 0; row < training.matrix_rows; ++row )
+  {
+    training.sample[row] = row;
+  }
+}
+
+Dataset::RealMatrix * training_matrix(
+  TrainingSet & training,
+  const unsigned int col_count,
+  const Options & options )
+{
+  Dataset::RealMatrix * matrix = new Dataset::RealMatrix(
+    training.matrix, training.matrix_rows, col_count, training.layout );
+  matrix->set_mapped( training.mapped );
+  if ( options.storage == Dataset::DoubleStorage )
+  {
+    return matrix;
+  }
+
+  // Copy the sample into compact storage and train from the copy instead. Rows
+  // this process loaded are released; shared or mapped rows stay until
+  // release_training_set(), but are not read again.
+  Dataset::RealMatrix * compact = null(Dataset::RealMatrix);
+  {
+    Dataset sample( *matrix, training.sample.size() );
+    for ( unsigned int row = 0; row < sample.row_count(); ++row )
+    {
+      sample(row) = training.sample[row];
+    }
+    compact = new Dataset::RealMatrix( sample, options.storage, options.storage_codes );
+  }
+  delete matrix;
+  vector<double>().swap( training.data );
+  training.matrix = null(double);
+  training.matrix_rows = compact->row_count();
+  training.layout = Dataset::ColumnMajor;
+  training.mapped = false;
+  for ( unsigned int row = 0; row < training.matrix_rows; ++row )
+  {
+    training.sample[row] = row;
+  }
+  return compact;
+}
+
+void release_training_set( TrainingSet & training )
+{
+  if ( training.window != MPI_WIN_NULL )
+  {
+    MPI_Win_free( &training.window );
+  }
+  if ( training.node_comm != MPI_COMM_NULL )
+  {
+    MPI_Comm_free( &training.node_comm );
+  }
+  training.source.columns.close();
+}
+
+void configure_keys(
+  Dataset & dataset,
+  Dataset::KeyList & split_keys,
+  const Schema & schema )
+{
+  Dataset::KeyList & keys = dataset.get_keys();
+  schema.name_keys( keys );
+
+  // Determine split keys. All keys except the label.
+  split_keys = keys;
+  split_keys.erase( schema.get_names()[0] );
+}
+
+void write_checkpoint(
+  const Options & options,
+  const unsigned int first_tree,
+  const string & tree_buffer )
+{
+  if ( !options.checkpoint.empty() )
+  {
+    stringstream filename;
+    filename << options.checkpoint << "/trees_" << first_tree << ".tree";
+    ofstream checkpoint_out( filename.str().c_str(), ios_base::out | ios_base::binary );
+    checkpoint_out.write( tree_buffer.data(), tree_buffer.size() );
+  }
+}
 
-int main( int argc, char ** argv )
+void * grow_master_trees( void * grower_pointer )
 {
-  int is_initialized = 0;
+  MasterGrower * grower = reinterpret_cast<MasterGrower*>(grower_pointer);
+  const Options & options = *grower->options;
 
-  // Determine if MPI has been initialized already.
-  MPI_Initialized(&is_initialized);
-  if (!is_initialized)
-  {
-    // Initialize MPI.
-    MPI_Init(&argc, &argv);
+  // Leave a processor for the communication.
+  unsigned int threads = ( options.threads > 0 ) ?
+    options.threads : ThreadPool::hardware_concurrency();
+  RandomForest batch_forest;
+  batch_forest.set_histogram_bins( options.histogram_bins );
+  batch_forest.set_thread_count( (threads > 1) ? threads - 1 : 1 );
+  batch_forest.set_seed( options.seed, RandomForest::TreeStream );
+  batch_forest.set_progress( null(ostream) );
 
-    // Determine if this it the master process or a child.
-    int rank = 0;
-    int processes = 0;
-    char name[MPI_MAX_PROCESSOR_NAME];
-    int name_size = 0;
+  // Bin the sample once for every batch.
+  Dataset::BinnedMatrix * bins = null(Dataset::BinnedMatrix);
+  if ( options.histogram_bins > 0 )
+  {
+    bins = new Dataset::BinnedMatrix( *grower->dataset, 0, options.histogram_bins );
+    grower->dataset->set_bins( bins );
+  }
 
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &processes);
-    MPI_Get_processor_name(name, &name_size);
-    cout
-      << "Spawned [ P: " << processes << " R: "
-      << rank << " N: " << name << endl;
+  // Take batches until none are left.
+  unsigned int first_tree = 0;
+  unsigned int count = 0;
+  while ( grower->queue->take(first_tree, count) )
+  {
+    double start = seconds();
+    batch_forest.grow_forest(
+      *grower->dataset,
+      0,
+      grower->bootstrap_size,
+      *grower->split_keys,
+      grower->keys_per_node,
+      count,
+      first_tree );
+    grower->busy += seconds() - start;
+    ostringstream line;
+    line << "Master: Grew trees " << first_tree << " to " << first_tree + count - 1;
+    report( line.str() );
 
-    // Enough arguments?
-    if ( argc != 5 )
-    {
-      if ( rank == 0 )
-      {
-        cout
-          << "Usage: mpirun -n <1> rf <2> <3> <4> <5>\n"
-          << "  <1> - Number of nodes to use\n"
-          << "  <2> - Bootstrap divisor\n"
-          << "  <3> - Split keys per node\n"
-          << "  <4> - Trees per forest\n"
-          << "  <5> - Training set sample probability (%)" << endl;
-      }
-    }
-    else
+    if ( !options.checkpoint.empty() )
     {
-      double sample_probability = atof(argv[4]);
-
-      if (rank == processes-1)
-      {
-        if ( sample_probability < 1.0 )
-        {
-          sample_probability = 1.0;
-        }
-        if ( sample_probability > 100.0 )
-        {
-          sample_probability = 100.0;
-        }
-        execute_main( processes, sample_probability / 100.0 );
-      }
-      else
-      {
-        // Extract parameters.
-        unsigned int bootstrap_divisor = atoi(argv[1]);
-        unsigned int split_keys_per_node = atoi(argv[2]);
-        unsigned int trees_per_forest = atoi(argv[3]);
-        execute_child(
-          processes-1,
-          rank,
-          bootstrap_divisor,
-          split_keys_per_node,
-          trees_per_forest );
-      }
+      ostringstream tree_out;
+      batch_forest.serialize(tree_out);
+      write_checkpoint( options, first_tree, tree_out.str() );
     }
+    grower->forest.merge( batch_forest );
   }
 
-  // Finalize MPI.
-  MPI_Finalize();
+  if ( bins != null(Dataset::BinnedMatrix) )
+  {
+    grower->dataset->set_bins( null(Dataset::BinnedMatrix) );
+    delete bins;
+  }
+  return null(void);
+}
 
-  return 0;
+void report( const string & line )
+{
+  pthread_mutex_lock( &console_mutex );
+  cout << line << endl;
+  pthread_mutex_unlock( &console_mutex );
 }
 
-void execute_main( const int process_count, const double sample_probability )
+void execute_main(
+  const int process_count,
+  const unsigned int bootstrap_divisor,
+  const unsigned int split_keys_per_node,
+  const unsigned int trees_per_forest,
+  const double sample_probability,
+  const Schema & schema,
+  const Options & options,
+  const bool threaded )
 {
   unsigned int child_process_count = process_count - 1;
+  unsigned int rank = process_count - 1;
+  unsigned int col_count = schema.column_count();
 
   cout << "Master online: [CPC: " << child_process_count
     << ", SP: " << sample_probability << "%" << endl;
-  int sample_probability_int = static_cast<int>(RAND_MAX * sample_probability);
-
-  // Read data.
-  unsigned int col_count = 107; // Ignore first (ID) column and last (?) col.
-
-  // Buffers.
-  double row_buffer[col_count];
-  string line;
 
-  cout << "Master: Loading data..." << endl;
-  ifstream file( "data/seq_val_1_2.csv", ios_base::in );
-  while ( getline(file, line, '\n') )
+  // Load the training rows, sending the children theirs unless they load
+  // their own.
+  TrainingSet training;
+  training.node_comm = MPI_COMM_NULL;
+  training.window = MPI_WIN_NULL;
+  if ( options.load == SharedLoad )
   {
-    // Tokenize row.
-    vector<string> tokens = Tokenize(line, "\t");
-
-    // First element is the ID. Skip.
-    // Second element is the class (1 - somatic, 2 - germline, 3 - wildtype).
-    row_buffer[0] = ( atof(tokens[1].c_str()) <= 1.0 ) ? 1.0 : 0.0;
-
-    // Fetch the rest of the features.
-    for ( unsigned int col = 1; col < col_count; ++col )
+    load_shared( rank, sample_probability, options, schema, training );
+  }
+  else
+  {
+    if ( options.load == MasterLoad )
     {
-      row_buffer[col] = atof(tokens[col + 1].c_str());
+      distribute_rows( child_process_count, rank, sample_probability, options, schema, training.data );
+      index_rows( training, col_count );
     }
-
-    // Send to child.
-    for ( unsigned int child_rank = 0; child_rank < child_process_count; ++child_rank )
+    else
     {
-      if ( rand() < sample_probability_int )
-      {
-        MPI_Send(
-          &row_buffer,
-          col_count,
-          MPI_DOUBLE,
-          child_rank,
-          MessageTag::RowBuffer,
-          MPI_COMM_WORLD );
-      }
+      load_shard( rank, sample_probability, options, schema, training );
     }
   }
 
-  // Stop the loading.
-  cout << "Master: Loading finished. Sending terminate command to children..." << endl;
-  row_buffer[0] = numeric_limits<double>::quiet_NaN();
-  for ( unsigned int child_rank = 0; child_rank < child_process_count; ++child_rank )
+  // Generate the master's dataset.
+  Dataset::RealMatrix * data_matrix = training_matrix( training, col_count, options );
+  Dataset dsr(*data_matrix, training.sample.size());
+  for ( unsigned int row = 0; row < dsr.row_count(); ++row)
   {
-    // Send to child.
-    MPI_Send(
-      &row_buffer,
-      col_count,
-      MPI_DOUBLE,
-      child_rank,
-      MessageTag::RowBuffer,
-      MPI_COMM_WORLD );
+    dsr(row) = training.sample[row];
   }
+  Dataset::KeyList split_keys;
+  configure_keys( dsr, split_keys, schema );
 
   // Start forest.
   RandomForest forest;
+  forest.set_thread_count( options.threads );
+
+  // Hand out batches of trees until enough are grown. Each slave asks for a
+  // batch, sends the trees back when they are grown and asks again, so faster
+  // slaves grow more of the forest. The master grows batches too, on a thread
+  // of its own, while this thread serves the slaves. If MPI can't have other
+  // threads beside the one calling it, the master only grows what the slaves
+  // leave, after they finish.
+  unsigned int tree_total = trees_per_forest * process_count;
+  TreeQueue queue( tree_total, (options.tree_batch > 0) ? options.tree_batch : 1 );
+  MasterGrower grower;
+  grower.queue = &queue;
+  grower.dataset = &dsr;
+  grower.split_keys = &split_keys;
+  grower.bootstrap_size = dsr.row_count() / bootstrap_divisor;
+  grower.keys_per_node = split_keys_per_node;
+  grower.options = &options;
+  grower.busy = 0.0;
+  // Without a grower thread, the master grows its trees after the slaves.
+  pthread_t grower_thread;
+  bool grower_started = false;
+  if ( !threaded )
+  {
+    cerr << "Master: MPI lacks MPI_THREAD_FUNNELED support; growing after the slaves."
+      << endl;
+  }
+  else if ( pthread_create( &grower_thread, NULL, grow_master_trees, &grower ) != 0 )
+  {
+    cerr << "Master: Can't start the grower thread; growing after the slaves." << endl;
+  }
+  else
+  {
+    grower_started = true;
+  }
 
-  // Grab the trees.
+  unsigned int active_children = child_process_count;
+  vector<unsigned int> child_trees( child_process_count, 0 );
+  vector<double> child_busy( child_process_count, 0.0 );
   MPI_Status status;
-  for ( unsigned int child_rank = 0; child_rank < child_process_count; ++child_rank )
+  while ( active_children > 0 )
   {
-    cout << "Master: Waiting on slave " << child_rank << "..." << endl;
+    MPI_Probe( MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status );
+    int child_rank = status.MPI_SOURCE;
+    if ( status.MPI_TAG == MessageTag::TreeData )
+    {
+      // Size the buffer to the message.
+      int size = 0;
+      MPI_Get_count( &status, MPI_BYTE, &size );
+      string tree_buffer( size, '\0' );
+      MPI_Recv(
+        &tree_buffer[0],
+        size,
+        MPI_BYTE,
+        child_rank,
+        MessageTag::TreeData,
+        MPI_COMM_WORLD,
+        &status );
 
-    // Wait on child.
-    unsigned int wait = 0;
-    MPI_Recv(
-      &wait,
-      1,
-      MPI_UNSIGNED,
-      child_rank,
-      MessageTag::TreeFinished,
-      MPI_COMM_WORLD,
-      &status );
+      // Append forest.
+      unsigned int previous_size = forest.get_size();
+      istringstream tree_in( tree_buffer );
+      forest.deserialize_append(tree_in);
+      child_trees[child_rank] += forest.get_size() - previous_size;
+    }
+    else if ( status.MPI_TAG == MessageTag::TreeRequest )
+    {
+      MPI_Recv(
+        &child_busy[child_rank],
+        1,
+        MPI_DOUBLE,
+        child_rank,
+        MessageTag::TreeRequest,
+        MPI_COMM_WORLD,
+        &status );
 
-    // Load slave file.
-    stringstream filename;
-    filename << "data/output/slave_" << child_rank << ".tree";
-    ifstream tree_in( filename.str().c_str(), ios_base::in | ios_base::binary );
+      // Next batch, or an empty one to stop.
+      unsigned int batch[2];
+      queue.take( batch[0], batch[1] );
+      MPI_Send(
+        batch,
+        2,
+        MPI_UNSIGNED,
+        child_rank,
+        MessageTag::TreeBatch,
+        MPI_COMM_WORLD );
+      if ( batch[1] == 0 )
+      {
+        --active_children;
+        ostringstream line;
+        line << "Master: Slave " << child_rank << " finished";
+        report( line.str() );
+      }
+    }
+  }
 
-    // Append forest.
-    forest.deserialize_append(tree_in);
+  // Collect the master's own trees.
+  if ( grower_started )
+  {
+    pthread_join( grower_thread, NULL );
+  }
+  else
+  {
+    grow_master_trees( &grower );
+  }
+  unsigned int master_trees = grower.forest.get_size();
+  forest.merge( grower.forest );
+  delete data_matrix;
+  release_training_set( training );
 
-    // Done.
-    tree_in.close();
+  // Report the balance.
+  for ( unsigned int child_rank = 0; child_rank < child_process_count; ++child_rank )
+  {
+    cout << "Master: Slave " << child_rank << " grew " << child_trees[child_rank]
+      << " trees in " << child_busy[child_rank] << " s" << endl;
   }
+  cout << "Master: Grew " << master_trees << " trees in " << grower.busy << " s" << endl;
   cout << "Master: Loaded all forests (" << forest.get_size() << ")! Classifying..." << endl;
 
-  // Load testing data.
+  save_model( forest, options );
+  if ( options.score == DistributedScore )
+  {
+    test_forest_distributed( forest, rank, process_count, false, schema, options );
+  }
+  else
+  {
+    test_forest( forest, schema, options );
+  }
+}
 
-  // Load in dataset.
-  vector<string> lines;
-  ifstream file_tr( "data/wgss_test.csv", ios_base::in );
-  while ( getline(file_tr, line, '\n') )
+void save_model( RandomForest & forest, const Options & options )
+{
+  // Save the forest for scoring elsewhere.
+  if ( !options.model.empty() )
   {
-    lines.push_back( line );
+    ofstream model_out( options.model.c_str(), ios_base::out | ios_base::binary );
+    forest.write_model( model_out );
   }
+}
 
-  // Tokenize first line.
-  vector<string> l1t;
-  l1t = Tokenize(lines[0], "\t");
+void load_test_rows(
+  vector<double> & data,
+  unsigned int & col_count,
+  const Schema & schema,
+  const Options & options )
+{
+  // The test set has the training set's layout.
+  DataSource source;
+  open_data( source, "wgss_test", schema, options );
+  unsigned long row_count = source.reader->count_rows();
+  col_count = source.reader->column_count();
+  data.resize( row_count * col_count );
+  Dataset::RealMatrix matrix( &data[0], row_count, col_count );
+  source.reader->read( matrix );
+}
 
-  // Create dataset.
-  unsigned int row_count = lines.size();
-  col_count = l1t.size() - 1; // Ignore first (ID) column and last (?) col.
+void count_confusion(
+  const RandomForest & forest,
+  double * const rows,
+  const unsigned int row_count,
+  const unsigned int col_count,
+  unsigned int confusion[ConfusionCells] )
+{
+  for ( unsigned int cell = 0; cell < ConfusionCells; ++cell )
+  {
+    confusion[cell] = 0;
+  }
+  if ( row_count == 0 )
+  {
+    return;
+  }
 
   // Dataset.
-  Dataset dsr_test( row_count, col_count );
-
-  // Convert data.
+  Dataset::RealMatrix test_matrix( rows, row_count, col_count );
+  Dataset dsr_test( test_matrix, row_count );
   for ( unsigned int row = 0; row < row_count; ++row )
   {
-    // Tokenize row.
-    vector<string> tokens = Tokenize(lines[row], "\t");
-
-    // First element is the ID. Skip.
-    // Second element is the class (1 - somatic, 2 - germline, 3 - wildtype).
-    dsr_test[row][0] = ( atof(tokens[1].c_str()) <= 1.0 ) ? 1.0 : 0.0;
-
-    // Fetch the rest of the features.
-    for ( unsigned int col = 1; col < col_count; ++col )
-    {
-      dsr_test[row][col] = atof(tokens[col + 1].c_str());
-    }
+    dsr_test(row) = row;
   }
 
-  // Classify the training data.
-  unsigned int tp = 0;
-  unsigned int tn = 0;
-  unsigned int fp = 0;
-  unsigned int fn = 0;
-  for ( unsigned int row = 0; row < dsr_test.row_count(); ++row )
+  // Classify the testing data.
+  bool * classifications = new bool[row_count];
+  forest.classify_batch( dsr_test, classifications );
+  for ( unsigned int row = 0; row < row_count; ++row )
   {
-    bool c = forest.classify(dsr_test[row]);
+    bool c = classifications[row];
     bool t = dsr_test[row][0] == 1.0;
 
-    if ( c && t ) ++tp;
-    else if ( c && !t ) ++fp;
-    else if ( !c && t ) ++fn;
-    else if ( !c && !t ) ++ tn;
+    if ( c && t ) ++confusion[TruePositive];
+    else if ( c && !t ) ++confusion[FalsePositive];
+    else if ( !c && t ) ++confusion[FalseNegative];
+    else if ( !c && !t ) ++confusion[TrueNegative];
     else cout << "????" << endl;
   }
+  delete [] classifications;
+}
+
+void report_confusion( const unsigned int confusion[ConfusionCells] )
+{
+  unsigned int tp = confusion[TruePositive];
+  unsigned int fp = confusion[FalsePositive];
+  unsigned int tn = confusion[TrueNegative];
+  unsigned int fn = confusion[FalseNegative];
   double accuracy = (tp + tn) * 100.0 / (tp + fp + tn + fn);
   double precision = tp * 100.0 / (tp + fp);
   double true_negative_rate = tn * 100.0 / (tn + fp);
@@ -268,16 +1619,116 @@ void execute_main( const int process_count, const double sample_probability )
     << "Recall            : " << recall << "%" << endl;
 }
 
+void test_forest(
+  RandomForest & forest,
+  const Schema & schema,
+  const Options & options )
+{
+  // Load testing data.
+  vector<double> test_data;
+  unsigned int col_count = 0;
+  load_test_rows( test_data, col_count, schema, options );
+
+  unsigned int confusion[ConfusionCells];
+  count_confusion( forest, &test_data[0], test_data.size() / col_count, col_count, confusion );
+  report_confusion( confusion );
+}
+
+void test_forest_distributed(
+  RandomForest & forest,
+  const unsigned int rank,
+  const int process_count,
+  const bool forest_shared,
+  const Schema & schema,
+  const Options & options )
+{
+  unsigned int master_rank = process_count - 1;
+
+  // Give every process the master's forest, unless they grew it together.
+  if ( !forest_shared )
+  {
+    string forest_buffer;
+    if ( rank == master_rank )
+    {
+      ostringstream forest_out;
+      forest.serialize( forest_out );
+      forest_buffer = forest_out.str();
+    }
+    unsigned long size = forest_buffer.size();
+    MPI_Bcast( &size, 1, MPI_UNSIGNED_LONG, master_rank, MPI_COMM_WORLD );
+    forest_buffer.resize( size );
+    MPI_Bcast( &forest_buffer[0], size, MPI_BYTE, master_rank, MPI_COMM_WORLD );
+    if ( rank != master_rank )
+    {
+      istringstream forest_in( forest_buffer );
+      forest.deserialize( forest_in );
+    }
+  }
+
+  // The master loads the test rows and deals out contiguous ranges of them.
+  vector<double> test_data;
+  unsigned int shape[2] = { 0, 0 };
+  if ( rank == master_rank )
+  {
+    load_test_rows( test_data, shape[1], schema, options );
+    shape[0] = test_data.size() / shape[1];
+  }
+  MPI_Bcast( shape, 2, MPI_UNSIGNED, master_rank, MPI_COMM_WORLD );
+  unsigned int row_total = shape[0];
+  unsigned int col_count = shape[1];
+
+  vector<int> counts( process_count );
+  vector<int> offsets( process_count );
+  for ( int process = 0; process < process_count; ++process )
+  {
+    unsigned int first = static_cast<unsigned long>(row_total) * process / process_count;
+    unsigned int end = static_cast<unsigned long>(row_total) * (process + 1) / process_count;
+    counts[process] = (end - first) * col_count;
+    offsets[process] = first * col_count;
+  }
+  vector<double> rows( counts[rank] + 1 );
+  MPI_Scatterv(
+    test_data.empty() ? null(double) : &test_data[0],
+    &counts[0],
+    &offsets[0],
+    MPI_DOUBLE,
+    &rows[0],
+    counts[rank],
+    MPI_DOUBLE,
+    master_rank,
+    MPI_COMM_WORLD );
+
+  // Score the local rows and add up the confusion matrices on the master.
+  double start = MPI_Wtime();
+  unsigned int local_confusion[ConfusionCells];
+  unsigned int confusion[ConfusionCells];
+  count_confusion(
+    forest, &rows[0], (col_count > 0) ? counts[rank] / col_count : 0, col_count,
+    local_confusion );
+  double busy = MPI_Wtime() - start;
+  MPI_Reduce(
+    local_confusion, confusion, ConfusionCells, MPI_UNSIGNED, MPI_SUM,
+    master_rank, MPI_COMM_WORLD );
+
+  if ( rank == master_rank )
+  {
+    cout << "Master: Scored " << row_total << " rows on " << process_count
+      << " processes (own share in " << busy << " s)" << endl;
+    report_confusion( confusion );
+  }
+}
 
 void execute_child(
   const unsigned int parent_rank,
   const unsigned int rank,
   const unsigned int bootstrap_divisor,
   const unsigned int split_keys_per_node,
-  const unsigned int trees_per_forest )
+  const unsigned int trees_per_forest,
+  const double sample_probability,
+  const Schema & schema,
+  const Options & options )
 {
-  unsigned int col_count = 107; // Ignore first (ID) column and last (?) col.
-  unsigned int feature_count = col_count - 1; // Class and n-1 features.
+  unsigned int col_count = schema.column_count();
 
   MPI_Status status;
 
@@ -285,136 +1736,229 @@ void execute_child(
     << bootstrap_divisor << ", SK: " << split_keys_per_node
     << ", TPF: " << trees_per_forest << "]" << endl;
 
-  cout << "Slave " << rank << ": Waiting on rows..." << endl;
-  vector<double> data;
-  double buffer[col_count];
-  buffer[0] = 0.0;
-  while ( true )
+  TrainingSet training;
+  training.node_comm = MPI_COMM_NULL;
+  training.window = MPI_WIN_NULL;
+  if ( options.load == SharedLoad )
   {
-    MPI_Recv(
-      &buffer,
-      col_count,
-      MPI_DOUBLE,
-      parent_rank,
-      MessageTag::RowBuffer,
-      MPI_COMM_WORLD,
-      &status );
-
-    // Stop on NaN.
-    if ( buffer[0] != buffer[0] )
+    cout << "Slave " << rank << ": Sharing the node's data..." << endl;
+    load_shared( rank, sample_probability, options, schema, training );
+  }
+  else
+  {
+    if ( options.load == DistributedLoad )
     {
-      break;
+      cout << "Slave " << rank << ": Loading its sample..." << endl;
+      load_shard( rank, sample_probability, options, schema, training );
     }
-
-    // Add elements to data vector.
-    for ( unsigned int col = 0; col < col_count; ++col )
+    else
     {
-      data.push_back(buffer[col]);
+      cout << "Slave " << rank << ": Waiting on rows..." << endl;
+      receive_rows( parent_rank, rank, col_count, options.storage, training.data );
+      index_rows( training, col_count );
     }
   }
 
   cout << "Slave " << rank << ": Finished loading data..." << endl;
 
   // Generate matrix.
-  Dataset::RealMatrix data_matrix(&data[0], data.size()/col_count, col_count);
+  Dataset::RealMatrix * data_matrix = training_matrix( training, col_count, options );
 
   // Generate dataset.
-  Dataset dsr(data_matrix, data_matrix.row_count());
+  Dataset dsr(*data_matrix, training.sample.size());
   for ( unsigned int row = 0; row < dsr.row_count(); ++row)
   {
-    dsr(row) = row;
+    dsr(row) = training.sample[row];
   }
 
   // Configure keys.
-  Dataset::KeyList & keys = dsr.get_keys();
-  keys["class"] = 0;
-  for ( unsigned int feature = 1; feature <= feature_count; ++feature )
+  Dataset::KeyList split_keys;
+  configure_keys( dsr, split_keys, schema );
+
+  // Data should be loaded. Time to grow the forest, a batch at a time.
+  RandomForest forest;
+  forest.set_histogram_bins( options.histogram_bins );
+  forest.set_thread_count( options.threads );
+  forest.set_seed( options.seed, RandomForest::TreeStream );
+
+  // Bin the sample once for every batch.
+  Dataset::BinnedMatrix * bins = null(Dataset::BinnedMatrix);
+  if ( options.histogram_bins > 0 )
   {
-    stringstream feature_ident;
-    feature_ident << "f" << feature;
-    keys[feature_ident.str()] = feature;
+    bins = new Dataset::BinnedMatrix( dsr, 0, options.histogram_bins );
+    dsr.set_bins( bins );
   }
-  // Determine split keys. All keys except class.
-  Dataset::KeyList split_keys = dsr.get_keys();
-  split_keys.erase("class");
 
-  // Data should be loaded. Time to grow the forest.
-  cout << "Slave " << rank << ": Growing tree..." << endl;
-  RandomForest forest;
-  forest.grow_forest(
-    dsr,
-    0,
-    dsr.row_count() / bootstrap_divisor,
-    split_keys,
-    split_keys_per_node,
-    trees_per_forest );
-  cout << "Slave " << rank << ": Grown! Seralizing and sending..." << endl;
+  double busy = 0.0;
+  while ( true )
+  {
+    // Ask for trees.
+    MPI_Send(
+      &busy,
+      1,
+      MPI_DOUBLE,
+      parent_rank,
+      MessageTag::TreeRequest,
+      MPI_COMM_WORLD );
+    unsigned int batch[2];
+    MPI_Recv(
+      batch,
+      2,
+      MPI_UNSIGNED,
+      parent_rank,
+      MessageTag::TreeBatch,
+      MPI_COMM_WORLD,
+      &status );
+    if ( batch[1] == 0 )
+    {
+      break;
+    }
+
+    cout << "Slave " << rank << ": Growing trees " << batch[0]
+      << " to " << batch[0] + batch[1] - 1 << "..." << endl;
+    double start = MPI_Wtime();
+    forest.grow_forest(
+      dsr,
+      0,
+      dsr.row_count() / bootstrap_divisor,
+      split_keys,
+      split_keys_per_node,
+      batch[1],
+      batch[0] );
+    busy += MPI_Wtime() - start;
+
+    ostringstream tree_out;
+    forest.serialize(tree_out);
+    string tree_buffer = tree_out.str();
+
+    // Checkpoint the trees.
+    write_checkpoint( options, batch[0], tree_buffer );
+
+    // Send the trees.
+    MPI_Send(
+      &tree_buffer[0],
+      tree_buffer.size(),
+      MPI_BYTE,
+      parent_rank,
+      MessageTag::TreeData,
+      MPI_COMM_WORLD );
+  }
 
-  stringstream filename;
-  filename << "data/output/slave_" << rank << ".tree";
-  ofstream tree_out( filename.str().c_str(), ios_base::out | ios_base::binary );
-  forest.serialize(tree_out);
-  tree_out.close();
+  // Release the shared data.
+  if ( bins != null(Dataset::BinnedMatrix) )
+  {
+    dsr.set_bins( null(Dataset::BinnedMatrix) );
+    delete bins;
+  }
+  delete data_matrix;
+  release_training_set( training );
 
   cout << "Slave " << rank << ": Finished." << endl;
 
-  // Send finished signal.
-  unsigned int wait = 1;
-  MPI_Send(
-    &wait,
-    1,
-    MPI_UNSIGNED,
-    parent_rank,
-    MessageTag::TreeFinished,
-    MPI_COMM_WORLD );
+  // Help score the master's forest.
+  if ( options.score == DistributedScore )
+  {
+    test_forest_distributed( forest, rank, parent_rank + 1, false, schema, options );
+  }
 }
 
-vector<string> std::Tokenize(const string& str,const string& delimiters)
+void execute_data_parallel(
+  const unsigned int rank,
+  const int process_count,
+  const unsigned int bootstrap_divisor,
+  const unsigned int split_keys_per_node,
+  const unsigned int trees_per_forest,
+  const double sample_probability,
+  const Schema & schema,
+  const Options & options )
 {
-  vector<string> tokens;
-  string::size_type delimPos = 0, tokenPos = 0, pos = 0;
+  unsigned int col_count = schema.column_count();
+
+  // Load this process's partition of the rows.
+  TrainingSet training;
+  training.node_comm = MPI_COMM_NULL;
+  training.window = MPI_WIN_NULL;
+  load_partition( rank, process_count, sample_probability, options, schema, training.data );
+  index_rows( training, col_count );
+  cout << "Process " << rank << ": Loaded " << training.matrix_rows << " rows." << endl;
 
-  if(str.length() < 1)
+  Dataset::RealMatrix * data_matrix = training_matrix( training, col_count, options );
+  Dataset dsr(*data_matrix, training.sample.size());
+  for ( unsigned int row = 0; row < dsr.row_count(); ++row)
   {
-    return tokens;
+    dsr(row) = training.sample[row];
   }
+  Dataset::KeyList split_keys;
+  configure_keys( dsr, split_keys, schema );
+
+  // Grow every tree together, as many as the other modes grow in total.
+  MpiHistogramReducer reducer( MPI_COMM_WORLD );
+  RandomForest forest;
+  forest.set_histogram_bins( options.histogram_bins );
+  forest.set_thread_count( options.threads );
+  forest.set_seed( options.seed, rank );
+  double start = MPI_Wtime();
+  forest.grow_forest_distributed(
+    dsr,
+    0,
+    dsr.row_count() / bootstrap_divisor,
+    split_keys,
+    split_keys_per_node,
+    trees_per_forest * process_count,
+    reducer );
+  double busy = MPI_Wtime() - start;
+  delete data_matrix;
 
-  while (true)
+  // Every process holds the same forest.
+  bool is_master = ( rank == static_cast<unsigned int>(process_count - 1) );
+  if ( is_master )
+  {
+    cout << "Master: Grew " << forest.get_size() << " trees with "
+      << process_count << " processes in " << busy << " s. Classifying..." << endl;
+    save_model( forest, options );
+  }
+  if ( options.score == DistributedScore )
+  {
+    test_forest_distributed( forest, rank, process_count, true, schema, options );
+  }
+  else if ( is_master )
   {
-    delimPos = str.find_first_of(delimiters, pos);
-    tokenPos = str.find_first_not_of(delimiters, pos);
+    test_forest( forest, schema, options );
+  }
+}
 
-    if(string::npos != delimPos)
-    {
-      if(string::npos != tokenPos)
-      {
-        if(tokenPos<delimPos)
-        {
-          tokens.push_back(str.substr(pos,delimPos-pos));
-        }
-        else
-        {
-          tokens.push_back("");
-        }
-      }
-      else
-      {
-        tokens.push_back("");
-      }
-      pos = delimPos+1;
-    }
-    else
+void execute_scoring(
+  const unsigned int rank,
+  const int process_count,
+  const Schema & schema,
+  const Options & options )
+{
+  // Every process maps the model itself, so they all hold the same forest.
+  RandomForest forest;
+  int mapped = forest.map_model( options.score_model ) ? 1 : 0;
+  int all_mapped = 0;
+  MPI_Allreduce( &mapped, &all_mapped, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD );
+  bool is_master = ( rank == static_cast<unsigned int>(process_count - 1) );
+  if ( all_mapped == 0 )
+  {
+    if ( !mapped )
     {
-      if(string::npos != tokenPos)
-      {
-        tokens.push_back(str.substr(pos));
-      }
-      else
-      {
-        tokens.push_back("");
-      }
-      break;
+      cerr << "Process " << rank << ": Can't map model " << options.score_model << endl;
     }
+    return;
+  }
+
+  if ( is_master )
+  {
+    cout << "Master: Mapped " << forest.get_size() << " trees from "
+      << options.score_model << ". Classifying..." << endl;
+  }
+  if ( options.score == DistributedScore )
+  {
+    test_forest_distributed( forest, rank, process_count, true, schema, options );
+  }
+  else if ( is_master )
+  {
+    test_forest( forest, schema, options );
   }
-  return tokens;
 }
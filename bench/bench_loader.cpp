@@ -0,0 +1,146 @@
+/*
+ * bench_loader.cpp
+ *
+ * Measures text parsing throughput of TextLoader, on one thread and on all
+ * of them, against getline() + atof().
+ */
+
+#include "TextLoader.h"
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdlib.h>
+#include <sys/time.h>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+double seconds( void )
+{
+  timeval time;
+  gettimeofday( &time, NULL );
+  return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+//------------------------------------------------------------------------------
+
+/**
+ * Parses a file with TextLoader.
+ * @param filename The tab-separated file.
+ * @param threads Parsing threads, 0 for one per processor.
+ * @param [out] checksum Sum of every value read.
+ * @return Elapsed time in seconds.
+ */
+double time_loader(
+  const char * const filename,
+  const unsigned int threads,
+  double & checksum )
+{
+  double start = seconds();
+  TextLoader loader;
+  loader.set_id_column( 0 );
+  loader.set_label_column( 1 );
+  loader.set_thread_count( threads );
+  loader.open( filename );
+  Dataset::RealMatrix matrix( loader.count_rows(), loader.column_count() );
+  loader.read( matrix );
+  double elapsed = seconds() - start;
+
+  checksum = 0.0;
+  for ( unsigned int row = 0; row < matrix.row_count(); ++row )
+  {
+    for ( unsigned int column = 0; column < matrix.column_count(); ++column )
+    {
+      checksum += matrix.at( row, column );
+    }
+  }
+  return elapsed;
+}
+
+//------------------------------------------------------------------------------
+
+/**
+ * Parses a file line by line, splitting fields into strings and converting
+ * them with atof(), as the application used to.
+ * @param filename The tab-separated file.
+ * @param [out] checksum Sum of every value read.
+ * @return Elapsed time in seconds.
+ */
+double time_getline( const char * const filename, double & checksum )
+{
+  double start = seconds();
+  vector<double> values;
+  string line;
+  string field;
+  ifstream file( filename, ios_base::in );
+  while ( getline(file, line, '\n') )
+  {
+    istringstream fields( line );
+    unsigned int index = 0;
+    while ( getline(fields, field, '\t') )
+    {
+      // Skip the ID.
+      if ( index++ > 0 )
+      {
+        values.push_back( atof(field.c_str()) );
+      }
+    }
+  }
+  double elapsed = seconds() - start;
+
+  checksum = 0.0;
+  for ( unsigned int value = 0; value < values.size(); ++value )
+  {
+    checksum += values[value];
+  }
+  return elapsed;
+}
+
+//------------------------------------------------------------------------------
+
+int main( int argc, char ** argv )
+{
+  const char * filename = ( argc > 1 ) ? argv[1] : "data/seq_val_1_2.csv";
+  unsigned int repetitions = ( argc > 2 ) ? atoi(argv[2]) : 10;
+  unsigned int threads     = ( argc > 3 ) ? atoi(argv[3]) : ThreadPool::hardware_concurrency();
+
+  ifstream file( filename, ios_base::in | ios_base::ate );
+  double megabytes = static_cast<double>( file.tellg() ) / (1024 * 1024);
+  if ( megabytes <= 0 )
+  {
+    cout << "Can't read " << filename << endl;
+    return 1;
+  }
+
+  cout
+    << filename << ", " << fixed << setprecision(2) << megabytes << " MB, "
+    << repetitions << " repetitions\n"
+    << setw(14) << left << "Parser"
+    << setw(12) << right << "Time (s)"
+    << setw(12) << "MB/s"
+    << setw(20) << "Checksum" << endl;
+
+  stringstream threaded;
+  threaded << "TextLoader x" << threads;
+  string names[] = { "TextLoader", threaded.str(), "getline+atof" };
+  for ( unsigned int parser = 0; parser < 3; ++parser )
+  {
+    double elapsed = 0.0;
+    double checksum = 0.0;
+    for ( unsigned int pass = 0; pass < repetitions; ++pass )
+    {
+      elapsed += ( parser < 2 ) ?
+        time_loader( filename, (parser == 0) ? 1 : threads, checksum ) : time_getline( filename, checksum );
+    }
+    cout
+      << setw(14) << left << names[parser]
+      << setw(12) << right << fixed << setprecision(4) << elapsed / repetitions
+      << setw(12) << setprecision(1) << megabytes * repetitions / elapsed
+      << setw(20) << scientific << setprecision(10) << checksum << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * bench_split.cpp
+ *
+ * Compares split search throughput on row-major and column-major data.
+ */
+
+#include "Dataset.h"
+
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+#include <sys/time.h>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+double seconds( void )
+{
+  timeval time;
+  gettimeofday( &time, NULL );
+  return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+//------------------------------------------------------------------------------
+
+/**
+ * Times information_gain() over every feature column of a dataset.
+ * @param data The dataset to search.
+ * @param repetitions Number of passes over all features.
+ * @return Elapsed time in seconds.
+ */
+double time_split_search( Dataset & data, const unsigned int repetitions )
+{
+  unsigned int columns = data.data_matrix().column_count();
+  double checksum = 0.0;
+  double start = seconds();
+  for ( unsigned int pass = 0; pass < repetitions; ++pass )
+  {
+    for ( unsigned int column = 1; column < columns; ++column )
+    {
+      double threshold = 0.0;
+      checksum += data.information_gain( 0, column, threshold ) + threshold;
+    }
+  }
+  double elapsed = seconds() - start;
+
+  // Keep the work observable.
+  if ( checksum != checksum )
+  {
+    cout << "NaN checksum" << endl;
+  }
+  return elapsed;
+}
+
+//------------------------------------------------------------------------------
+
+/**
+ * Times enumerate_threshold() over every feature column of a dataset. This is
+ * a plain column scan, which is where the layout matters most.
+ * @param data The dataset to scan.
+ * @param repetitions Number of passes over all features.
+ * @return Elapsed time in seconds.
+ */
+double time_column_scan( Dataset & data, const unsigned int repetitions )
+{
+  unsigned int columns = data.data_matrix().column_count();
+  unsigned int checksum = 0;
+  double start = seconds();
+  for ( unsigned int pass = 0; pass < repetitions * 20; ++pass )
+  {
+    for ( unsigned int column = 1; column < columns; ++column )
+    {
+      checksum += data.enumerate_threshold( column, 10.0 )[Dataset::Greater];
+    }
+  }
+  double elapsed = seconds() - start;
+
+  // Keep the work observable.
+  if ( checksum == 0 )
+  {
+    cout << "Empty scan" << endl;
+  }
+  return elapsed / 20;
+}
+
+//------------------------------------------------------------------------------
+
+void report(
+  const char * const name,
+  const unsigned int rows,
+  const unsigned int features,
+  const unsigned int repetitions,
+  const double elapsed )
+{
+  double cells = static_cast<double>(rows) * features * repetitions;
+  cout
+    << setw(14) << left << name
+    << setw(10) << right << rows
+    << setw(12) << fixed << setprecision(4) << elapsed
+    << setw(16) << setprecision(0) << cells / elapsed << endl;
+}
+
+//------------------------------------------------------------------------------
+
+int main( int argc, char ** argv )
+{
+  // Defaults match data/seq_val_1_2.csv: class plus 106 features.
+  unsigned int rows        = ( argc > 1 ) ? atoi(argv[1]) : 3369;
+  unsigned int columns     = ( argc > 2 ) ? atoi(argv[2]) : 107;
+  unsigned int repetitions = ( argc > 3 ) ? atoi(argv[3]) : 5;
+  unsigned int features    = columns - 1;
+
+  // Fill both layouts with the same values. Features take few distinct
+  // values, like the count and flag columns in the real data.
+  Dataset row_major( rows, columns, Dataset::RowMajor );
+  Dataset column_major( rows, columns, Dataset::ColumnMajor );
+  srand( 1 );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    for ( unsigned int column = 0; column < columns; ++column )
+    {
+      double value = ( column == 0 ) ? (rand() % 2) : (rand() % 200) / 10.0;
+      row_major.value( row, column ) = value;
+      column_major.value( row, column ) = value;
+    }
+  }
+
+  // Bootstrap samples reference the rows in random order.
+  unsigned int sample_size = rows / 3;
+  RandomStream random( 1 );
+  Dataset row_major_sample = row_major.bootstrap_sample( sample_size, random );
+  Dataset column_major_sample( column_major, sample_size );
+  for ( unsigned int row = 0; row < sample_size; ++row )
+  {
+    column_major_sample(row) = row_major_sample(row);
+  }
+
+  Dataset * datasets[] =
+    { &row_major, &column_major, &row_major_sample, &column_major_sample };
+  const char * names[] =
+    { "row-major", "column-major", "row-major", "column-major" };
+
+  cout
+    << rows << " rows x " << features << " features, "
+    << repetitions << " repetitions\n";
+  for ( unsigned int scan = 0; scan < 2; ++scan )
+  {
+    cout
+      << ( (scan == 0) ? "Split search (information_gain):\n" : "Column scan (enumerate_threshold):\n" )
+      << setw(14) << left << "Layout"
+      << setw(10) << right << "Rows"
+      << setw(12) << "Time (s)"
+      << setw(16) << "Cells/s" << endl;
+    for ( unsigned int d = 0; d < 4; ++d )
+    {
+      double elapsed = ( scan == 0 ) ?
+        time_split_search( *datasets[d], repetitions ) :
+        time_column_scan( *datasets[d], repetitions );
+      report( names[d], datasets[d]->row_count(), features, repetitions, elapsed );
+    }
+  }
+
+  return 0;
+}
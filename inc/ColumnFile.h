@@ -0,0 +1,191 @@
+/*
+ * ColumnFile.h
+ */
+
+#ifndef __ColumnFile_h__
+#define __ColumnFile_h__
+
+#include "DataFile.h"
+#include "Dataset.h"
+#include "RowReader.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Reads and writes binary column files (see DataFile.h). An open file is
+ * mapped and viewed in place as a column-major matrix, so loading a parsed
+ * dataset costs no more than mapping it. The mapping is private: writes to the
+ * matrix are not written back to the file. The matrix is marked as mapped, so
+ * training from it pages in only the columns it examines (see
+ * Dataset::prefetch_column()), and a file can be larger than memory.
+ */
+class ColumnFile : public RowReader
+{
+  public:
+    /**
+     * Rows convert() reads and writes at a time.
+     */
+    static const unsigned int ConvertBlockRows = 4096;
+
+  public:
+    /**
+     * Constructor.
+     */
+    ColumnFile( void );
+
+    /**
+     * Destructor. Unmaps the file.
+     */
+    virtual ~ColumnFile( void )
+    {
+      close();
+    }
+
+    /**
+     * Write a matrix as a column file.
+     * @param filename The file to write.
+     * @param matrix The matrix, in any layout and storage.
+     * @param keys The column names.
+     * @param label_column The column of the classification label.
+     * @param source How the rows were parsed, if from text.
+     * @return True if the file was written.
+     */
+    static bool write(
+      const std::string & filename,
+      const Dataset::RealMatrix & matrix,
+      const Dataset::KeyList & keys,
+      const unsigned int label_column = 0,
+      const DataFile::Source & source = DataFile::Source() );
+
+    /**
+     * Read every row of a reader and write them as a column file. The rows
+     * are converted ConvertBlockRows at a time, each block written into place
+     * in every column, so memory stays bounded whatever the file size. The
+     * file is written under a temporary name and renamed into place, so
+     * processes converting the same file at once don't see a partial one.
+     * @param reader The rows to convert. It is rewound first.
+     * @param filename The file to write.
+     * @param keys The column names.
+     * @param source How the reader parses its rows, if from text.
+     * @return True if the file was written.
+     */
+    static bool convert(
+      RowReader & reader,
+      const std::string & filename,
+      const Dataset::KeyList & keys,
+      const DataFile::Source & source = DataFile::Source() );
+
+    /**
+     * Map and check a column file, and rewind to its first row.
+     * @param filename The file to read.
+     * @return True if the file was mapped and is valid.
+     */
+    bool open( const std::string & filename );
+
+    /**
+     * Unmap the file.
+     */
+    void close( void );
+
+    /**
+     * Return the mapped matrix. Only valid while the file is open.
+     * @return Column-major matrix.
+     */
+    Dataset::RealMatrix & get_matrix( void )
+    {
+      return *matrix;
+    }
+
+    /**
+     * Return the column names.
+     * @return Key list.
+     */
+    const Dataset::KeyList & get_keys( void ) const
+    {
+      return keys;
+    }
+
+    /**
+     * Return the column of the classification label.
+     * @return Label column.
+     */
+    unsigned int get_label_column( void ) const
+    {
+      return label_column;
+    }
+
+    /**
+     * Return how the text the file was converted from was parsed.
+     * @return Source settings, all 0 if not recorded.
+     */
+    const DataFile::Source & get_source( void ) const
+    {
+      return source;
+    }
+
+    virtual unsigned int column_count( void ) const;
+    virtual unsigned long count_rows( void ) const;
+    virtual void rewind( void )
+    {
+      next = 0;
+    }
+    virtual bool next_row( double * const row );
+    virtual bool skip_row( void );
+    virtual unsigned long read( Dataset::RealMatrix & matrix );
+    virtual unsigned long read_selected(
+      Dataset::RealMatrix & matrix,
+      const std::vector<bool> & keep );
+
+  private:
+    /**
+     * Describe a column file: its header and name table.
+     * @param row_count The number of rows.
+     * @param column_count The number of columns.
+     * @param keys The column names.
+     * @param label_column The column of the classification label.
+     * @param source How the rows were parsed, if from text.
+     * @param [out] header The header.
+     * @param [out] names The name table.
+     */
+    static void describe(
+      const unsigned long row_count,
+      const unsigned int column_count,
+      const Dataset::KeyList & keys,
+      const unsigned int label_column,
+      const DataFile::Source & source,
+      DataFile::Header & header,
+      std::string & names );
+
+    /**
+     * Write all of a buffer at an offset of a file.
+     * @param descriptor The file.
+     * @param data The buffer.
+     * @param size The buffer size in bytes.
+     * @param offset The file offset.
+     * @return True if it was all written.
+     */
+    static bool write_at(
+      const int descriptor,
+      const void * const data,
+      const std::size_t size,
+      const uint64_t offset );
+
+    /**
+     * Check the header and read the name table.
+     * @return True if the mapped file is valid.
+     */
+    bool load( void );
+
+  private:
+    void * map;                   ///< The mapped file.
+    std::size_t map_size;         ///< File size in bytes.
+    Dataset::RealMatrix * matrix; ///< View of the column blocks.
+    Dataset::KeyList keys;        ///< Column names.
+    unsigned int label_column;    ///< Label column.
+    DataFile::Source source;      ///< How the source text was parsed.
+    unsigned long next;           ///< Next row to read.
+};
+
+#endif
@@ -12,8 +12,12 @@ namespace MessageTag
 {
   enum MessageTagEnum
   {
-    RowBuffer,
-    TreeFinished
+    RowBuffer,    ///< A batch of whole rows, as MPI_DOUBLE (MPI_FLOAT for float storage).
+    TreeData,     ///< A child's serialized forest, as MPI_BYTE.
+    RowCount,     ///< The number of rows to come, before them, as MPI_UNSIGNED_LONG.
+    TreeRequest,  ///< A slave asks for trees; its busy seconds, as MPI_DOUBLE.
+    TreeBatch     ///< First tree index and tree count, as 2 MPI_UNSIGNED;
+                  ///< a count of 0 means stop.
   };
 }
 
@@ -0,0 +1,86 @@
+/*
+ * DataFile.h
+ */
+
+#ifndef __DataFile_h__
+#define __DataFile_h__
+
+#include <stdint.h>
+
+/**
+ * Layout of a binary column file, a parsed copy of a text dataset that can be
+ * mapped and trained on directly. The file is written in the byte order of the
+ * machine that wrote it:
+ *
+ *    Header
+ *    name table    records of { uint32_t column; uint32_t length;
+ *                  char name[length]; }, matching Dataset::KeyList
+ *    padding       up to a multiple of ColumnAlignment
+ *    column blocks column_count blocks of row_count doubles; column c starts
+ *                  at column_offset + c * row_count * sizeof(double)
+ *
+ * All offsets are in bytes from the start of the file.
+ */
+namespace DataFile
+{
+  /**
+   * File signature.
+   */
+  static const char Magic[8] = { 'R', 'F', 'D', 'A', 'T', 'A', '\0', '\0' };
+
+  /**
+   * Byte order mark. Reads back byte-swapped on a machine of the other
+   * endianness.
+   */
+  static const uint32_t ByteOrderMark = 0x01020304u;
+
+  /**
+   * Current format version.
+   */
+  static const uint32_t Version = 3;
+
+  /**
+   * Alignment of the first column block, in bytes.
+   */
+  static const uint64_t ColumnAlignment = 64;
+
+  /**
+   * Field index meaning "no such field".
+   */
+  static const uint32_t NoField = 0xFFFFFFFFu;
+
+  /**
+   * Defines how the text a file was converted from was parsed. A cached copy
+   * is only current if it was parsed the same way.
+   */
+  struct Source
+  {
+    uint32_t delimiter;             ///< Field delimiter character.
+    uint32_t id_field;              ///< Field of the row ID, or NoField.
+    uint32_t label_field;           ///< Field of the classification label.
+    uint32_t header_line;           ///< 1 if the first line named the fields.
+    uint32_t label_threshold;       ///< 1 if labels were mapped to 1 up to
+                                    ///< positive_max and 0 above it.
+    uint32_t reserved;              ///< Padding, 0.
+    double positive_max;            ///< Largest positive label, or 0.
+  };
+
+  /**
+   * Defines the file header.
+   */
+  struct Header
+  {
+    char magic[8];                  ///< Magic.
+    uint32_t byte_order;            ///< ByteOrderMark, in the writer's order.
+    uint32_t version;               ///< Format version.
+    uint32_t column_count;          ///< Columns, including the label.
+    uint32_t label_column;          ///< Column of the classification label.
+    uint64_t row_count;             ///< Rows.
+    uint64_t name_table_offset;     ///< Offset of the name table.
+    uint64_t name_table_size;       ///< Size of the name table in bytes.
+    uint64_t column_offset;         ///< Offset of the first column block.
+    Source source;                  ///< How the source text was parsed.
+  };
+}
+
+#endif
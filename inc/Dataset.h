@@ -1,13 +1,17 @@
 #ifndef __Dataset_h__
 #define __Dataset_h__
 
+#include <assert.h>
 #include <math.h>
+#include <stdint.h>
 #include <string>
 #include <map>
 #include <vector>
 #include <string.h>
 #include <iomanip>
 
+#include "RandomStream.h"
+
 #define null(type) reinterpret_cast<type*>(0)
 
 class DatasetSplitPair;
@@ -19,32 +23,176 @@ class Dataset
 {
   public:
     /**
-     * Represents a probability map, which is an associative array with the added
-     * entropy calculation function.
+     * Represents a class histogram, which is a fixed-size array of integer
+     * class counts with impurity measures computed from the counts.
      */
-    class ProbabilityMap : public std::map<std::string, double>
+    template <unsigned int Classes>
+    class ClassHistogram
     {
       public:
         /**
-         * Determines the entropy of the probability map in base 10.
-         * @return Entropy in base 10.
+         * Constructor. All counts start at zero.
+         */
+        ClassHistogram( void )
+        {
+          clear();
+        }
+
+        /**
+         * Reset all counts to zero.
+         */
+        void clear( void )
+        {
+          memset( counts, 0, sizeof(counts) );
+        }
+
+        /**
+         * Count one element of a class.
+         * @param class_index The class of the element.
+         */
+        void add( const unsigned int class_index )
+        {
+          ++counts[class_index];
+        }
+
+        /**
+         * Add the counts of another histogram.
+         * @param other The histogram to add.
+         */
+        void add( const ClassHistogram & other )
+        {
+          for ( unsigned int c = 0; c < Classes; ++c )
+          {
+            counts[c] += other.counts[c];
+          }
+        }
+
+        /**
+         * Subtract the counts of another histogram.
+         * @param other The histogram to subtract. Its counts must not exceed
+         *      the counts of this histogram.
+         */
+        void subtract( const ClassHistogram & other )
+        {
+          for ( unsigned int c = 0; c < Classes; ++c )
+          {
+            counts[c] -= other.counts[c];
+          }
+        }
+
+        /**
+         * Count accessor.
+         * @param class_index The class.
+         * @return Reference to the class count.
          */
-        inline double entropy( void ) const
+        const unsigned int & operator[]( const unsigned int class_index ) const
         {
+          return counts[class_index];
+        }
+        unsigned int & operator[]( const unsigned int class_index )
+        {
+          return counts[class_index];
+        }
+
+        /**
+         * Determine the total number of elements counted.
+         * @return Sum of all class counts.
+         */
+        unsigned int total( void ) const
+        {
+          unsigned int sum = 0;
+          for ( unsigned int c = 0; c < Classes; ++c )
+          {
+            sum += counts[c];
+          }
+          return sum;
+        }
+
+        /**
+         * Determine the probability of a class.
+         * @param class_index The class.
+         * @return Class probability, or 0 if the histogram is empty.
+         */
+        double probability( const unsigned int class_index ) const
+        {
+          unsigned int sum = total();
+          return ( sum > 0 ) ? counts[class_index] / static_cast<double>(sum) : 0.0;
+        }
+
+        /**
+         * Determine the most frequent class. Ties go to the lowest class.
+         * @return The majority class.
+         */
+        unsigned int majority( void ) const
+        {
+          unsigned int best = 0;
+          for ( unsigned int c = 1; c < Classes; ++c )
+          {
+            if ( counts[c] > counts[best] )
+            {
+              best = c;
+            }
+          }
+          return best;
+        }
+
+        /**
+         * Determines the entropy of the class distribution in base 2.
+         * @return Entropy in base 2.
+         */
+        double entropy( void ) const
+        {
+          unsigned int sum = total();
           double entropy = 0.0;
-          for (
-            ProbabilityMap::const_iterator iter = this->begin();
-            iter != this->end(); ++iter )
+          for ( unsigned int c = 0; c < Classes; ++c )
           {
-            if ( iter->second > 0.0 )
+            if ( (counts[c] > 0) && (counts[c] < sum) )
             {
-              entropy -= iter->second * log10(iter->second) / log10(2.0);
+              double probability = counts[c] / static_cast<double>(sum);
+              entropy -= probability * log10(probability) / log10(2.0);
             }
           }
           return entropy;
         }
+
+        /**
+         * Determines the Gini impurity of the class distribution.
+         * @return Gini impurity.
+         */
+        double gini( void ) const
+        {
+          unsigned int sum = total();
+          if ( sum == 0 )
+          {
+            return 0.0;
+          }
+          double gini = 1.0;
+          for ( unsigned int c = 0; c < Classes; ++c )
+          {
+            double probability = counts[c] / static_cast<double>(sum);
+            gini -= probability * probability;
+          }
+          return gini;
+        }
+
+      private:
+        unsigned int counts[Classes]; ///< Class counts.
     };
 
+    /**
+     * Defines the two sides of a threshold.
+     */
+    enum ThresholdSide
+    {
+      LessEqual = 0,  ///< Elements <= the threshold.
+      Greater   = 1   ///< Elements > the threshold.
+    };
+
+    /**
+     * Defines a histogram of elements on each side of a threshold.
+     */
+    typedef ClassHistogram<2> ThresholdHistogram;
+
     /**
      * Defines a list of keys.
      */
@@ -66,6 +214,7 @@ class Dataset
          * @param rows Rows in column.
          */
         IntegerColumn( const unsigned int rows ) :
+          owned(true),
           rows(rows)
         {
           // Allocate data column.
@@ -73,17 +222,34 @@ class Dataset
           memset( data, 0, sizeof(*data)*rows );
         }
 
+        /**
+         * Constructor. Views existing data without copying it.
+         * @param data Pointer to data.
+         * @param rows Rows in column.
+         */
+        IntegerColumn( unsigned int * const data, const unsigned int rows ) :
+          owned(false),
+          rows(rows),
+          data(data)
+        {
+          //
+        }
+
         /**
          * Destructor.
          */
         ~IntegerColumn( void )
         {
-          delete [] data;
+          if ( owned )
+          {
+            delete [] data;
+          }
         }
 
         /**
          * Resize the column.
          * @param new_rows Rows in column.
+         * @note A column viewing existing data copies it into its own storage.
          */
         void resize( const unsigned int new_rows )
         {
@@ -100,9 +266,13 @@ class Dataset
               memset( &new_data[rows], 0, sizeof(*new_data)*(new_rows - rows) );
             }
 
-            delete [] data;
+            if ( owned )
+            {
+              delete [] data;
+            }
             data = new_data;
             rows = new_rows;
+            owned = true;
           }
         }
 
@@ -147,27 +317,77 @@ class Dataset
         }
 
       private:
+        bool owned;         ///< Whether or not the data is owned by this structure.
         unsigned int rows;  ///< Row count.
         unsigned int *data; ///< Row data.
     };
 
     /**
-     * Defines a double matrix.
+     * Defines the memory layout of a matrix.
+     */
+    enum Layout
+    {
+      RowMajor,     ///< Rows are contiguous (row-wise access).
+      ColumnMajor   ///< Columns are contiguous (per-feature scans).
+    };
+
+    /**
+     * Defines how a column of a mapped matrix is about to be read.
+     */
+    enum ColumnAccess
+    {
+      NormalAccess,     ///< No particular order (the default).
+      SequentialAccess, ///< Front to back.
+      PrefetchAccess    ///< Most of it, soon: start paging it in now.
+    };
+
+    /**
+     * Defines how the elements of a matrix are stored.
+     */
+    enum Storage
+    {
+      DoubleStorage,  ///< One double per element (the default).
+      FloatStorage,   ///< One float per element.
+      CodeStorage     ///< One 8- or 16-bit code per element, per-column values.
+    };
+
+    /**
+     * Defines a real matrix. Elements are doubles unless the matrix is a
+     * compact copy of another, made with a different Storage: float copies
+     * round every element to single precision, and code copies replace every
+     * element with an index into a per-column table of values. A column with
+     * at most max_codes distinct values keeps them all, so coding it is
+     * exact; a column with more is bucketed into max_codes quantile bins like
+     * a BinnedMatrix and every element becomes its bin's upper edge, which
+     * still splits the rows exactly as the original values would. Columns
+     * with at most 256 values take one byte per element and the rest two.
      */
     class RealMatrix
     {
       public:
+        /**
+         * The largest number of codes a column may be stored with.
+         */
+        static const unsigned int MaxCodes = 65536;
+
         /**
          * Constructor.
          * @param rows Rows in matrix.
          * @param columns Columns in matrix.
+         * @param layout Memory layout of the matrix.
          */
-        RealMatrix( const unsigned int rows, const unsigned int columns ) :
-          owned(true), rows(rows), columns(columns)
+        RealMatrix(
+          const unsigned int rows,
+          const unsigned int columns,
+          const Layout layout = RowMajor ) :
+            owned(true), mapped(false), storage(DoubleStorage),
+            rows(rows), columns(columns), layout(layout),
+            floats(null(float))
         {
           // Allocate data matrix.
           data = new double[rows*columns];
           memset( data, 0, sizeof(*data)*rows*columns );
+          set_strides();
         }
 
         /**
@@ -175,16 +395,34 @@ class Dataset
          * @param data Pointer to data.
          * @param rows Rows in matrix.
          * @param columns Columns in matrix.
+         * @param layout Memory layout of the data.
          */
         RealMatrix(
           double * const data,
           const unsigned int rows,
-          const unsigned int columns ) :
-            owned(false), rows(rows), columns(columns), data(data)
+          const unsigned int columns,
+          const Layout layout = RowMajor ) :
+            owned(false), mapped(false), storage(DoubleStorage),
+            rows(rows), columns(columns), layout(layout), data(data),
+            floats(null(float))
         {
-          //
+          set_strides();
         }
 
+        /**
+         * Constructor. Copies the rows of a dataset into a ColumnMajor matrix
+         * of the given storage, e.g. to train from a smaller copy of the
+         * sampled rows.
+         * @param source The rows to copy, in order.
+         * @param storage How to store the elements.
+         * @param max_codes The maximum number of codes per column (<=
+         *      MaxCodes), for CodeStorage.
+         */
+        RealMatrix(
+          const Dataset & source,
+          const Storage storage,
+          const unsigned int max_codes = MaxCodes );
+
         /**
          * Destructor.
          */
@@ -194,6 +432,7 @@ class Dataset
           {
             delete [] data;
           }
+          delete [] floats;
         }
 
         /**
@@ -214,25 +453,378 @@ class Dataset
           return columns;
         }
 
+        /**
+         * Get the memory layout.
+         * @return Matrix layout.
+         */
+        Layout get_layout( void ) const
+        {
+          return layout;
+        }
+
+        /**
+         * Get the element storage.
+         * @return Matrix storage.
+         */
+        Storage get_storage( void ) const
+        {
+          return storage;
+        }
+
+        /**
+         * Determine the memory the elements take, including code tables.
+         * @return Size in bytes.
+         */
+        unsigned long byte_size( void ) const;
+
+        /**
+         * Mark the data as a file mapping, which advise_column() passes hints
+         * on for.
+         * @param mapped True if the data is mapped from a file.
+         */
+        void set_mapped( const bool mapped )
+        {
+          this->mapped = mapped;
+        }
+
+        /**
+         * Determine if the data is a file mapping.
+         * @return True if mapped.
+         */
+        bool is_mapped( void ) const
+        {
+          return mapped;
+        }
+
+        /**
+         * Tell the kernel how a column is about to be read, so a matrix
+         * larger than memory pages in what is needed. Only mapped ColumnMajor
+         * matrices take hints; for others this does nothing.
+         * @param column Matrix column.
+         * @param access How it will be read.
+         */
+        void advise_column( const unsigned int column, const ColumnAccess access ) const;
+
+        /**
+         * Element accessor. Works for either layout.
+         * @param row Matrix row.
+         * @param column Matrix column.
+         * @return Reference to the element.
+         * @note Only valid for DoubleStorage. Use get() otherwise.
+         */
+        const double & at( const unsigned int row, const unsigned int column ) const
+        {
+          assert( storage == DoubleStorage );
+          return data[row*row_stride + column*column_stride];
+        }
+        double & at( const unsigned int row, const unsigned int column )
+        {
+          assert( storage == DoubleStorage );
+          return data[row*row_stride + column*column_stride];
+        }
+
+        /**
+         * Element value. Works for any layout and storage.
+         * @param row Matrix row.
+         * @param column Matrix column.
+         * @return The element.
+         */
+        double get( const unsigned int row, const unsigned int column ) const
+        {
+          if ( storage == DoubleStorage )
+          {
+            return data[row*row_stride + column*column_stride];
+          }
+          if ( storage == FloatStorage )
+          {
+            return floats[column*rows + row];
+          }
+          const CodeColumn & code_column = code_columns[column];
+          unsigned int code = code_column.wide.empty()
+            ? code_column.narrow[row]
+            : code_column.wide[row];
+          return code_column.values[code];
+        }
+
+        /**
+         * Copy a row into a buffer. Works for any layout and storage.
+         * @param row Matrix row.
+         * @param buffer Buffer of at least column_count() elements.
+         */
+        void copy_row( const unsigned int row, double * const buffer ) const
+        {
+          for ( unsigned int column = 0; column < columns; ++column )
+          {
+            buffer[column] = get( row, column );
+          }
+        }
+
         /**
          * Row accessor.
          * @param row Matrix row.
          * @return Pointer to matrix row.
+         * @note Only valid for RowMajor matrices, which are DoubleStorage.
+         *    Use get() or copy_row() otherwise.
          */
         const double * const operator[]( const unsigned int row ) const
         {
+          assert( layout == RowMajor );
+          assert( storage == DoubleStorage );
           return &data[row*columns];
         }
         double * const operator[]( const unsigned int row )
         {
+          assert( layout == RowMajor );
+          assert( storage == DoubleStorage );
           return &data[row*columns];
         }
 
+        /**
+         * Column accessor.
+         * @param column Matrix column.
+         * @return Pointer to matrix column.
+         * @note Only valid for ColumnMajor DoubleStorage matrices.
+         */
+        const double * const column_data( const unsigned int column ) const
+        {
+          assert( layout == ColumnMajor );
+          assert( storage == DoubleStorage );
+          return &data[column*rows];
+        }
+        double * const column_data( const unsigned int column )
+        {
+          assert( layout == ColumnMajor );
+          assert( storage == DoubleStorage );
+          return &data[column*rows];
+        }
+
+      private:
+        /**
+         * The codes of a column and the values they stand for.
+         */
+        struct CodeColumn
+        {
+          std::vector<unsigned char> narrow;  ///< Codes, if at most 256 values.
+          std::vector<unsigned short> wide;   ///< Codes, if more.
+          ThresholdVector values;             ///< Sorted value of every code.
+        };
+
+        /**
+         * Set element strides from the layout.
+         */
+        void set_strides( void )
+        {
+          row_stride = ( layout == RowMajor ) ? columns : 1;
+          column_stride = ( layout == RowMajor ) ? 1 : rows;
+        }
+
+        /**
+         * Choose the values of a column and code it.
+         * @param source The rows being copied.
+         * @param column Matrix column.
+         * @param max_codes The maximum number of codes.
+         */
+        void encode(
+          const Dataset & source,
+          const unsigned int column,
+          const unsigned int max_codes );
+
       private:
-        const bool owned;     ///< Whether or not the data is owned by this structure.
-        unsigned int rows;    ///< Rows in the matrix.
-        unsigned int columns; ///< Columns in the matrix.
-        double * data;        ///< The matrix data.
+        const bool owned;           ///< Whether or not the data is owned by this structure.
+        bool mapped;                ///< Whether or not the data is a file mapping.
+        const Storage storage;      ///< Element storage.
+        unsigned int rows;          ///< Rows in the matrix.
+        unsigned int columns;       ///< Columns in the matrix.
+        const Layout layout;        ///< Memory layout.
+        unsigned int row_stride;    ///< Distance between consecutive rows.
+        unsigned int column_stride; ///< Distance between consecutive columns.
+        double * data;              ///< The matrix data, for DoubleStorage.
+        float * floats;             ///< Column-major elements, for FloatStorage.
+        std::vector<CodeColumn> code_columns; ///< Per-column codes, for CodeStorage.
+    };
+
+    /**
+     * Defines a matrix of per-column quantile bin codes, one byte per cell.
+     * Each column is bucketed into at most max_bins bins once, and every bin
+     * is labelled with its upper edge, which is an actual value from the
+     * column. A value v falls into bin b iff it is <= edge b and > edge b-1,
+     * so splitting on an edge partitions the rows exactly like the bins do.
+     */
+    class BinnedMatrix
+    {
+      public:
+        /**
+         * The largest number of bins a column may be bucketed into.
+         */
+        static const unsigned int MaxBins = 256;
+
+        /**
+         * Constructor. Bins every column of the matrix.
+         * @param matrix The matrix to bin.
+         * @param decision_column The column of the classification label.
+         * @param max_bins The maximum number of bins per column (<= MaxBins).
+         */
+        BinnedMatrix(
+          const RealMatrix & matrix,
+          const unsigned int decision_column,
+          const unsigned int max_bins );
+
+        /**
+         * Constructor. Bins only the rows of a dataset, e.g. a sample of a
+         * matrix mapped from a file. Codes take a byte per column for each
+         * distinct row of the dataset, plus a bit per matrix row up to the
+         * last one to find them. Only those rows may be looked up.
+         * @param dataset The rows to bin.
+         * @param decision_column The column of the classification label.
+         * @param max_bins The maximum number of bins per column (<= MaxBins).
+         */
+        BinnedMatrix(
+          const Dataset & dataset,
+          const unsigned int decision_column,
+          const unsigned int max_bins );
+
+        /**
+         * Constructor. Bins every column of the matrix with given bin edges,
+         * e.g. edges agreed on by every process holding a shard of the data.
+         * @param matrix The matrix to bin.
+         * @param decision_column The column of the classification label.
+         * @param column_edges Sorted upper bin edges for every column, at most
+         *      MaxBins each. Values above the last edge fall into the last bin.
+         */
+        BinnedMatrix(
+          const RealMatrix & matrix,
+          const unsigned int decision_column,
+          const std::vector<ThresholdVector> & column_edges );
+
+        /**
+         * Destructor.
+         */
+        ~BinnedMatrix( void )
+        {
+          delete [] codes;
+          delete [] classes;
+        }
+
+        /**
+         * Choose the bin edges of a column from the bins of several shards of
+         * it, so processes can agree on edges without sharing their rows.
+         * Each candidate is the upper edge of a shard's bin, weighted by the
+         * rows in it. The edges are the candidates at each weighted quantile,
+         * and always end with the largest candidate.
+         * @param candidates Upper bin edges of every shard, in any order.
+         * @param weights Rows in the bin of each candidate.
+         * @param max_bins The maximum number of bins (<= MaxBins).
+         * @param [out] edges The edges, ascending.
+         */
+        static void merge_edges(
+          const ThresholdVector & candidates,
+          const std::vector<double> & weights,
+          const unsigned int max_bins,
+          ThresholdVector & edges );
+
+        /**
+         * Get the number of bins used by a column.
+         * @param column Matrix column.
+         * @return Bin count.
+         */
+        unsigned int bin_count( const unsigned int column ) const
+        {
+          return edges[column].size();
+        }
+
+        /**
+         * Get the upper edge of a bin.
+         * @param column Matrix column.
+         * @param bin Bin index.
+         * @return The largest value in the bin.
+         */
+        double edge( const unsigned int column, const unsigned int bin ) const
+        {
+          return edges[column][bin];
+        }
+
+        /**
+         * Bin code accessor.
+         * @param row Matrix row.
+         * @param column Matrix column.
+         * @return Bin index of the element.
+         */
+        unsigned char code( const unsigned int row, const unsigned int column ) const
+        {
+          return codes[column*rows + bin_row( row )];
+        }
+
+        /**
+         * Classification accessor.
+         * @param row Matrix row.
+         * @return True if the row's decision value is > 0.
+         */
+        bool classification( const unsigned int row ) const
+        {
+          return classes[bin_row( row )] != 0;
+        }
+
+      private:
+        /**
+         * Find where the codes of a matrix row are kept.
+         * @param row Matrix row.
+         * @return Row of the codes.
+         */
+        unsigned int bin_row( const unsigned int row ) const
+        {
+          if ( row_ranks.empty() )
+          {
+            return row;
+          }
+          unsigned int word = row / 64;
+          uint64_t below = row_bits[word] & ( (static_cast<uint64_t>(1) << (row % 64)) - 1 );
+          return row_ranks[word] + __builtin_popcountll( below );
+        }
+
+        /**
+         * Choose the bin edges of every column and code it.
+         * @param matrix The matrix to bin.
+         * @param max_bins The maximum number of bins per column.
+         * @param matrix_rows The matrix row of every binned row, or empty for
+         *      all of them.
+         */
+        void bin(
+          const RealMatrix & matrix,
+          const unsigned int max_bins,
+          const std::vector<unsigned int> & matrix_rows );
+
+        /**
+         * Record the classifications.
+         * @param matrix The matrix to bin.
+         * @param decision_column The column of the classification label.
+         * @param matrix_rows The matrix row of every binned row, or empty for
+         *      all of them.
+         */
+        void classify(
+          const RealMatrix & matrix,
+          const unsigned int decision_column,
+          const std::vector<unsigned int> & matrix_rows );
+
+        /**
+         * Encode a column against its bin edges.
+         * @param matrix The matrix to bin.
+         * @param column Matrix column.
+         * @param matrix_rows The matrix row of every binned row, or empty for
+         *      all of them.
+         */
+        void encode(
+          const RealMatrix & matrix,
+          const unsigned int column,
+          const std::vector<unsigned int> & matrix_rows );
+
+      private:
+        unsigned int rows;                ///< Rows in the matrix.
+        unsigned int columns;             ///< Columns in the matrix.
+        unsigned char * codes;            ///< Column-major bin codes.
+        unsigned char * classes;          ///< Per-row binary classification.
+        std::vector<ThresholdVector> edges; ///< Per-column bin upper edges.
+        std::vector<uint64_t> row_bits;     ///< Binned matrix rows, if not all.
+        std::vector<unsigned int> row_ranks; ///< Binned rows before each word.
     };
 
   public:
@@ -240,8 +832,12 @@ class Dataset
      * Constructor.
      * @param rows Data rows.
      * @param columns Data columns.
+     * @param layout Memory layout of the data.
      */
-    Dataset( const unsigned int rows, const unsigned int columns );
+    Dataset(
+      const unsigned int rows,
+      const unsigned int columns,
+      const Layout layout = RowMajor );
 
     /**
      * Constructor.
@@ -250,6 +846,16 @@ class Dataset
      */
     Dataset( Dataset & reference, const unsigned int rows );
 
+    /**
+     * Constructor. Views the rows [begin, end) of a reference dataset, sharing
+     * its reference indices without copying them. Reordering the rows of
+     * either dataset is visible in the other.
+     * @param reference Dataset reference.
+     * @param begin First row of the range.
+     * @param end One past the last row of the range.
+     */
+    Dataset( Dataset & reference, const unsigned int begin, const unsigned int end );
+
     /**
      * Constructor.
      * @param data Dataset reference.
@@ -267,11 +873,11 @@ class Dataset
      * threshold.
      * @param column The column to evaluate.
      * @param threshold The threshold to split on (<= threshold; > threshold).
-     * @return A probability map containing the elements 'LE' for the elements
-     *      less than or equal to the threshold and 'G' for the elements greater
-     *      than the threshold.
+     * @return A histogram counting the elements less than or equal to the
+     *      threshold under LessEqual and the elements greater than the
+     *      threshold under Greater.
      */
-    ProbabilityMap enumerate_threshold(
+    ThresholdHistogram enumerate_threshold(
       const unsigned int column, const double threshold ) const;
 
     /**
@@ -291,9 +897,31 @@ class Dataset
     DatasetSplitPair split(
       const unsigned int column, const double threshold );
 
+    /**
+     * Partition the dataset in place based on some constraint. Rows are
+     * reordered (not stably) so that the rows with data <= the threshold come
+     * first, followed by the rows with data > threshold.
+     * @param column The column to split on.
+     * @param threshold The value to split on (<= threshold; > threshold).
+     * @return The number of rows with data <= the threshold.
+     */
+    unsigned int partition(
+      const unsigned int column, const double threshold );
+
+    /**
+     * Start paging in a column of a mapped matrix if scanning this dataset's
+     * rows would touch most of its pages anyway, i.e. there are at least as
+     * many rows as the column has pages. Smaller datasets read only the pages
+     * they need.
+     * @param column The column about to be scanned.
+     */
+    void prefetch_column( const unsigned int column ) const;
+
     /**
      * Determines the information gain of a specific column with respect to a
-     * given decision column.
+     * given decision column. The attribute column is sorted once and swept with
+     * running class counts, so every distinct value is evaluated as a threshold
+     * in O(n log n) total.
      * @param [in] decision_column The decision (classification) column.
      * @param [in] attribute_column The attribute column to determine information
      *      gain on.
@@ -305,12 +933,52 @@ class Dataset
       const unsigned int attribute_column,
       double & threshold );
 
+    /**
+     * Determines the information gain of a specific column using the binned
+     * matrix attached with set_bins(). Rows are counted into per-bin class
+     * histograms and only the bin edges are evaluated as thresholds, so the
+     * cost is one pass over the rows plus a scan over at most MaxBins bins.
+     * @param [in] attribute_column The attribute column to determine information
+     *      gain on.
+     * @param [out] threshold The optimal splitting threshold (a bin edge).
+     * @return The information gain of splitting on the given column.
+     */
+    double information_gain_binned(
+      const unsigned int attribute_column,
+      double & threshold ) const;
+
+    /**
+     * Count the rows into per-bin class histograms of a column using the
+     * binned matrix attached with set_bins(). Histograms from disjoint sets of
+     * rows can be summed and passed to best_bin_split().
+     * @param [in] attribute_column The attribute column.
+     * @param [in,out] histograms The bin_count() histograms to add to.
+     */
+    void bin_histograms(
+      const unsigned int attribute_column,
+      ThresholdHistogram * const histograms ) const;
+
+    /**
+     * Find the best bin edge to split on from per-bin class histograms.
+     * @param [in] bins The binned matrix the histograms were counted with.
+     * @param [in] attribute_column The attribute column.
+     * @param [in] histograms The bin_count() class histograms of the column.
+     * @param [out] threshold The optimal splitting threshold (a bin edge).
+     * @return The information gain of splitting on the given column.
+     */
+    static double best_bin_split(
+      const BinnedMatrix & bins,
+      const unsigned int attribute_column,
+      const ThresholdHistogram * const histograms,
+      double & threshold );
+
     /**
      * Generate a bootstrap sample from the dataset (sampling with replacement).
      * @param sample_size The size of the boostrap sample.
+     * @param random The random stream to sample with.
      * @return Bootstrap sample.
      */
-    Dataset bootstrap_sample( const unsigned int sample_size );
+    Dataset bootstrap_sample( const unsigned int sample_size, RandomStream & random );
 
     /**
      * Get the out of bag set. This requires a dataset reference.
@@ -330,10 +998,31 @@ class Dataset
       return *data;
     }
 
+    /**
+     * Attach binned data used for histogram split finding. The bins must be
+     * built from this dataset's data matrix and outlive this dataset and any
+     * dataset referencing it.
+     * @param binned_matrix The bins, or null for exact split finding.
+     */
+    void set_bins( const BinnedMatrix * const binned_matrix )
+    {
+      bins = binned_matrix;
+    }
+
+    /**
+     * Return attached binned data.
+     * @return Binned matrix, or null if none is attached.
+     */
+    const BinnedMatrix * get_bins( void ) const
+    {
+      return bins;
+    }
+
     /**
      * Row accessor.
      * @param row Matrix row.
      * @return Pointer to matrix row.
+     * @note Only valid for RowMajor data. Use get() or copy_row() otherwise.
      */
     const double * const operator[]( const unsigned int row ) const
     {
@@ -346,6 +1035,43 @@ class Dataset
       return (*data)[data_index];
     }
 
+    /**
+     * Element accessor. Works for either layout.
+     * @param row Dataset row.
+     * @param column Data column.
+     * @return The element, or a reference to it to write to.
+     * @note Writing is only valid for DoubleStorage data, and asserts it.
+     */
+    double value( const unsigned int row, const unsigned int column ) const
+    {
+      return data->get( data_ref[row], column );
+    }
+    double & value( const unsigned int row, const unsigned int column )
+    {
+      return data->at( data_ref[row], column );
+    }
+
+    /**
+     * Element value. Works for any layout and storage.
+     * @param row Dataset row.
+     * @param column Data column.
+     * @return The element.
+     */
+    double get( const unsigned int row, const unsigned int column ) const
+    {
+      return data->get( data_ref[row], column );
+    }
+
+    /**
+     * Copy a row into a buffer. Works for any layout and storage.
+     * @param row Dataset row.
+     * @param buffer Buffer of at least as many elements as data columns.
+     */
+    void copy_row( const unsigned int row, double * const buffer ) const
+    {
+      data->copy_row( data_ref[row], buffer );
+    }
+
     /**
      * Determines the number of rows in reference dataset.
      * @return Number of rows.
@@ -409,6 +1135,7 @@ class Dataset
     KeyList                   keys;     ///< Dataset key list.
     IntegerColumn             data_ref; ///< Dataset reference indices.
     RealMatrix * const        data;     ///< Dataset data.
+    const BinnedMatrix *      bins;     ///< Binned data for histogram splits.
     const bool                usingRef; ///< Indicates whether or not using reference dataset.
 
   public:
@@ -0,0 +1,43 @@
+/*
+ * HistogramReducer.h
+ */
+
+#ifndef __HistogramReducer_h__
+#define __HistogramReducer_h__
+
+#include <vector>
+
+/**
+ * Combines split statistics across the processes that grow a tree together,
+ * each over its own shard of the rows. Every process must make the same
+ * sequence of calls with the same sizes. The MPI implementation lives with the
+ * application so the library doesn't depend on MPI.
+ */
+class HistogramReducer
+{
+  public:
+    /**
+     * Destructor.
+     */
+    virtual ~HistogramReducer( void )
+    {
+      //
+    }
+
+    /**
+     * Sum counts element-wise over all processes. Every process receives the
+     * totals.
+     * @param [in,out] counts The local counts, replaced by the totals.
+     */
+    virtual void sum( std::vector<unsigned int> & counts ) = 0;
+
+    /**
+     * Concatenate the values of every process, in process order. Every
+     * process receives the result.
+     * @param [in,out] values The local values, replaced by those of every
+     *      process. Processes may send different numbers of values.
+     */
+    virtual void gather( std::vector<double> & values ) = 0;
+};
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * ModelFile.h
+ */
+
+#ifndef __ModelFile_h__
+#define __ModelFile_h__
+
+#include <stdint.h>
+
+/**
+ * Layout of a flat forest model file. The file is written in the byte order
+ * of the machine that wrote it and can be mapped and classified from directly:
+ *
+ *    Header
+ *    tree table    tree_count + 1 uint64_t node indices; tree t owns the
+ *                  nodes [table[t], table[t+1])
+ *    node array    node_count RandomTree::CompiledNode, 8-byte aligned
+ *    string table  optional; records of { uint32_t column; uint32_t length;
+ *                  char name[length]; } naming the feature columns
+ *
+ * All offsets are in bytes from the start of the file.
+ */
+namespace ModelFile
+{
+  /**
+   * File signature.
+   */
+  static const char Magic[8] = { 'R', 'F', 'M', 'O', 'D', 'E', 'L', '\0' };
+
+  /**
+   * Byte order mark. Reads back byte-swapped on a machine of the other
+   * endianness.
+   */
+  static const uint32_t ByteOrderMark = 0x01020304u;
+
+  /**
+   * Current format version.
+   */
+  static const uint32_t Version = 2;
+
+  /**
+   * Defines the file header.
+   */
+  struct Header
+  {
+    char magic[8];                  ///< Magic.
+    uint32_t byte_order;            ///< ByteOrderMark, in the writer's order.
+    uint32_t version;               ///< Format version.
+    uint32_t tree_count;            ///< Number of trees.
+    uint32_t node_size;             ///< sizeof(RandomTree::CompiledNode).
+    uint64_t node_count;            ///< Total number of nodes.
+    uint64_t tree_table_offset;     ///< Offset of the tree table.
+    uint64_t node_offset;           ///< Offset of the node array.
+    uint64_t string_table_offset;   ///< Offset of the string table, 0 if absent.
+    uint64_t string_table_size;     ///< Size of the string table in bytes.
+    uint32_t column_count;          ///< Columns a row needs: every split
+                                    ///< column is below this.
+    uint32_t reserved;              ///< Zero; keeps the header 8-byte sized.
+  };
+}
+
+#endif
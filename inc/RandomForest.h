@@ -8,8 +8,12 @@
 #ifndef __RandomForest_h__
 #define __RandomForest_h__
 
+#include "HistogramReducer.h"
+#include "ModelFile.h"
 #include "RandomTree.h"
+#include "ThreadPool.h"
 
+#include <iostream>
 #include <pthread.h>
 #include <semaphore.h>
 
@@ -22,6 +26,15 @@ class RandomForest
     typedef std::vector<RandomTree*> Forest;
 
   private:
+    /**
+     * Defines a grown tree and its index in the forest.
+     */
+    struct Result
+    {
+      unsigned int index; ///< Tree index.
+      RandomTree * tree;  ///< The tree.
+    };
+
     /**
      * Defines a thread-safe result queue.
      */
@@ -40,10 +53,19 @@ class RandomForest
           sem_init( &semaphore, 0, 0 );
         }
 
+        /**
+         * Destructor.
+         */
+        ~ResultQueue( void )
+        {
+          sem_destroy( &semaphore );
+          pthread_mutex_destroy(&mutex);
+        }
+
         /**
          * Function to push a result tree.
          */
-        void push( RandomTree * result )
+        void push( const Result & result )
         {
           pthread_mutex_lock(&mutex);
           results.push_back(result);
@@ -53,13 +75,13 @@ class RandomForest
 
         /**
          * Pull next result.
-         * @return Pointer to a RandomTree.
+         * @return A grown tree and its index.
          */
-        RandomTree * pop( void )
+        Result pop( void )
         {
           sem_wait(&semaphore);
           pthread_mutex_lock(&mutex);
-          RandomTree *result = results[results.size()-1];
+          Result result = results[results.size()-1];
           results.pop_back();
           pthread_mutex_unlock(&mutex);
 
@@ -69,13 +91,13 @@ class RandomForest
       private:
         pthread_mutex_t mutex;  ///< Access mutex.
         sem_t semaphore;        ///< Data semaphore. Indicates data is available for reading.
-        Forest results;         ///< The results list.
+        std::vector<Result> results;  ///< The results list.
     };
 
     /**
-     * Defines a forest growing task.
+     * Defines a forest growing task. Each task index grows one tree.
      */
-    class ForestGrowingTask
+    class ForestGrowingTask : public ThreadPool::Task
     {
       public:
         /**
@@ -87,76 +109,168 @@ class RandomForest
           const unsigned int bootstrap_size,
           const Dataset::KeyList & split_keys,
           const unsigned int keys_per_node,
-          const unsigned int tree_count,
+          const uint64_t seed,
+          const unsigned int stream,
+          const unsigned int first_tree,
           ResultQueue * const result_queue ) :
             dataset(dataset),
             decision_column(decision_column),
             bootstrap_size(bootstrap_size),
             split_keys(split_keys),
             keys_per_node(keys_per_node),
-            tree_count(tree_count),
+            seed(seed),
+            stream(stream),
+            first_tree(first_tree),
             result_queue(result_queue)
         {
           //
         }
 
         /**
-         * Spawn the task.
-         * @return The return value of the thread creation routine.
+         * Grow one tree.
+         * @param tree_index The index of the tree.
          */
-        int spawn( void )
+        virtual void run( const unsigned int tree_index )
         {
-          return pthread_create(
-            &thread, NULL, ForestGrowingTask::route,
-            reinterpret_cast<void*>(this) );
+          // Each tree draws from its own random stream.
+          RandomStream random( seed, stream, first_tree + tree_index );
+
+          // Generate a bootstrap sample.
+          Dataset bootstrap = dataset.bootstrap_sample(bootstrap_size, random);
+
+          // Generate a random tree.
+          Result result;
+          result.index = tree_index;
+          result.tree = new RandomTree;
+          result.tree->grow_decision_tree(
+            bootstrap, split_keys, keys_per_node, decision_column, random );
+
+          // Push result.
+          result_queue->push(result);
         }
 
       private:
+        Dataset & dataset;
+        const unsigned int decision_column;
+        const unsigned int bootstrap_size;
+        const Dataset::KeyList & split_keys;
+        const unsigned int keys_per_node;
+        const uint64_t seed;
+        const unsigned int stream;
+        const unsigned int first_tree;
+        ResultQueue * const result_queue;
+    };
+
+    /**
+     * Defines a batch classification task. Each task index classifies one
+     * block of BatchBlockRows rows.
+     */
+    class BlockClassifyTask : public ThreadPool::Task
+    {
+      public:
         /**
-         * Thread routing function.
-         * @param class_pointer The pointer to the task class to execute.
-         * @return Null pointer (unused, required for interface).
+         * Constructor.
          */
-        static void * route( void * class_pointer )
+        BlockClassifyTask(
+          const RandomForest & forest,
+          const Dataset & dataset,
+          bool * const classifications ) :
+            forest(forest),
+            dataset(dataset),
+            classifications(classifications)
         {
-          ForestGrowingTask *task = reinterpret_cast<ForestGrowingTask*>(class_pointer);
-          task->run();
-          return null(void);
+          //
         }
 
         /**
-         * Run the task.
+         * Classify one block.
+         * @param block_index The index of the block.
          */
-        void run( void )
+        virtual void run( const unsigned int block_index )
         {
-          // Iteratively build each tree.
-          for ( unsigned int tree_index = 0; tree_index < tree_count; ++tree_index )
-          {
-            // Generate a bootstrap sample.
-            Dataset bootstrap = dataset.bootstrap_sample(bootstrap_size);
+          unsigned int rows = dataset.row_count();
+          unsigned int begin = block_index * BatchBlockRows;
+          unsigned int end = ( rows - begin > BatchBlockRows ) ? begin + BatchBlockRows : rows;
+          std::vector<unsigned int> votes( end - begin );
+          forest.classify_block( dataset, begin, end, &votes[0], classifications );
+        }
 
-            // Generate a random tree.
-            RandomTree *tree = new RandomTree;
-            tree->grow_decision_tree(
-              bootstrap, split_keys, keys_per_node, decision_column );
+      private:
+        const RandomForest & forest;
+        const Dataset & dataset;
+        bool * const classifications;
+    };
+
+    /**
+     * Defines a batch voting task for batches with too few blocks to keep the
+     * threads busy. Each task index runs every row through one share of the
+     * trees and keeps its own vote counters.
+     */
+    class TreeVoteTask : public ThreadPool::Task
+    {
+      public:
+        /**
+         * Constructor.
+         */
+        TreeVoteTask(
+          const RandomForest & forest,
+          const Dataset & dataset,
+          std::vector< std::vector<unsigned int> > & votes ) :
+            forest(forest),
+            dataset(dataset),
+            votes(votes)
+        {
+          //
+        }
 
-            // Push result.
-            result_queue->push(tree);
+        /**
+         * Count the votes of one share of the trees.
+         * @param share_index The index of the share.
+         */
+        virtual void run( const unsigned int share_index )
+        {
+          unsigned int tree_count = forest.forest.size();
+          unsigned int share_count = votes.size();
+          unsigned int begin = tree_count * share_index / share_count;
+          unsigned int end = tree_count * (share_index + 1) / share_count;
+          for ( unsigned int tree_index = begin; tree_index < end; ++tree_index )
+          {
+            forest.forest[tree_index]->vote_batch(
+              dataset, 0, dataset.row_count(), &votes[share_index][0] );
           }
         }
 
       private:
-        pthread_t thread;
-        Dataset & dataset;
-        const unsigned int decision_column;
-        const unsigned int bootstrap_size;
-        const Dataset::KeyList & split_keys;
-        const unsigned int keys_per_node;
-        const unsigned int tree_count;
-        ResultQueue * const result_queue;
+        const RandomForest & forest;
+        const Dataset & dataset;
+        std::vector< std::vector<unsigned int> > & votes;
     };
 
   public:
+    /**
+     * Constructor.
+     */
+    RandomForest( void ) :
+      histogram_bins(0),
+      thread_count(0),
+      seed(0),
+      stream(0),
+      progress(&std::cout),
+      model_data(null(const char)),
+      model_size(0),
+      model_map(null(void))
+    {
+      //
+    }
+
+    /**
+     * Destructor.
+     */
+    ~RandomForest( void )
+    {
+      burn();
+    }
+
     /**
      * Clears the built forest.
      */
@@ -171,16 +285,97 @@ class RandomForest
         *iter = null(RandomTree);
       }
       forest.clear();
+
+      // Release any model the trees were attached to.
+      release_model();
+    }
+
+    /**
+     * Moves the trees of another forest to the end of this one.
+     * @param other The forest to empty. Its trees must not be attached to a
+     *    model loaded with load_model() or map_model().
+     */
+    void merge( RandomForest & other )
+    {
+      forest.insert( forest.end(), other.forest.begin(), other.forest.end() );
+      other.forest.clear();
+    }
+
+    /**
+     * Select histogram split finding.
+     * @param bins The maximum number of quantile bins per feature (at most
+     *    Dataset::BinnedMatrix::MaxBins), or 0 for exact split finding.
+     */
+    void set_histogram_bins( const unsigned int bins )
+    {
+      histogram_bins = bins;
     }
 
     /**
-     * Grows a forest of random trees.
+     * Determine the histogram bin count.
+     * @return The maximum number of bins per feature, 0 for exact splits.
+     */
+    unsigned int get_histogram_bins( void ) const
+    {
+      return histogram_bins;
+    }
+
+    /**
+     * Select the number of threads used to grow the forest and to classify
+     * batches.
+     * @param threads The thread count, or 0 for one thread per processor.
+     */
+    void set_thread_count( const unsigned int threads )
+    {
+      thread_count = threads;
+    }
+
+    /**
+     * Determine the number of threads used to grow and classify.
+     * @return The thread count, 0 for one thread per processor.
+     */
+    unsigned int get_thread_count( void ) const
+    {
+      return thread_count;
+    }
+
+    /**
+     * Set where grow_forest() reports its progress.
+     * @param progress The stream to write to, or null for none.
+     */
+    void set_progress( std::ostream * const progress )
+    {
+      this->progress = progress;
+    }
+
+    /**
+     * Seed the random streams. Tree t is grown from the stream derived from
+     * (seed, stream, t), so a forest is reproducible whatever the thread count.
+     * Processes that take trees from a shared queue should all use TreeStream,
+     * so tree t draws the same numbers whichever process grows it.
+     * @param seed The forest seed.
+     * @param stream The stream number, e.g. TreeStream or the MPI rank.
+     */
+    void set_seed( const uint64_t seed, const unsigned int stream )
+    {
+      this->seed = seed;
+      this->stream = stream;
+    }
+
+    /**
+     * Grows a forest of random trees on get_thread_count() threads. With
+     * histogram bins set, bins attached to the dataset with set_bins() are
+     * used; otherwise the dataset's rows are binned for this call. Callers
+     * growing several batches from one dataset should bin it once.
      * @param dataset The dataset to use.
      * @param decision_column The column of the classification label.
      * @param bootstrap_size The size of the bootstrap samples.
      * @param split_keys The keys to split on.
      * @param keys_per_node The keys per node to compare for splits.
      * @param tree_count The number of trees to build.
+     * @param first_tree The stream index of the first tree. Growing trees
+     *    first_tree to first_tree+tree_count-1 in pieces gives the same trees
+     *    as growing them at once.
      */
     void grow_forest(
       Dataset & dataset,
@@ -188,7 +383,48 @@ class RandomForest
       const unsigned int bootstrap_size,
       const Dataset::KeyList & split_keys,
       const unsigned int keys_per_node,
-      const unsigned int tree_count );
+      const unsigned int tree_count,
+      const unsigned int first_tree = 0 );
+
+    /**
+     * The stream number the key choices of grow_forest_distributed() are drawn
+     * from. It must not be used as the stream number of any process.
+     */
+    static const unsigned int SharedStream = 0xFFFFFFFFu;
+
+    /**
+     * The stream number for trees handed out to processes in batches: tree t
+     * is drawn from (seed, TreeStream, t) on any process. The tree still
+     * depends on the rows of the process that grows it.
+     */
+    static const unsigned int TreeStream = 0xFFFFFFFEu;
+
+    /**
+     * Grows a forest together with other processes, each holding a different
+     * shard of the rows, for data too large for one process. Every process
+     * must call this with the same arguments apart from its dataset, and ends
+     * up with the same forest. The bin edges (get_histogram_bins() of them,
+     * or Dataset::BinnedMatrix::MaxBins if unset) are merged from the bins of
+     * every shard (see Dataset::BinnedMatrix::merge_edges()), each process
+     * bootstraps its own shard from stream (seed, stream, t), and the keys of
+     * tree t are chosen from stream (seed, SharedStream, t). Trees are grown
+     * one at a time on the calling thread.
+     * @param dataset The local shard.
+     * @param decision_column The column of the classification label.
+     * @param bootstrap_size The size of the local bootstrap samples.
+     * @param split_keys The keys to split on.
+     * @param keys_per_node The keys per node to compare for splits.
+     * @param tree_count The number of trees to build.
+     * @param reducer Combines the histograms of all processes.
+     */
+    void grow_forest_distributed(
+      Dataset & dataset,
+      const unsigned int decision_column,
+      const unsigned int bootstrap_size,
+      const Dataset::KeyList & split_keys,
+      const unsigned int keys_per_node,
+      const unsigned int tree_count,
+      HistogramReducer & reducer );
 
     /**
      * Classify a row using the majority vote from the forest.
@@ -197,6 +433,30 @@ class RandomForest
      */
     bool classify( const double * const & row );
 
+    /**
+     * Rows per block in classify_batch(). Each tree classifies a whole block
+     * before the next tree, so a tree stays in cache while the block streams
+     * through it.
+     */
+    static const unsigned int BatchBlockRows = 1024;
+
+    /**
+     * Smallest batch, in rows times trees, that classify_batch() spreads over
+     * threads. Smaller batches are classified serially, since starting the
+     * threads would cost more than it saves.
+     */
+    static const unsigned int ParallelBatchVotes = 1 << 18;
+
+    /**
+     * Classify every row of a dataset using the majority vote from the forest.
+     * Large batches are split into row blocks across get_thread_count()
+     * threads; batches with fewer blocks than threads split the trees instead.
+     * @param dataset The rows to classify (either layout).
+     * @param [out] classifications Buffer of dataset.row_count() elements that
+     *    receives the classification of each row.
+     */
+    void classify_batch( const Dataset & dataset, bool * const classifications ) const;
+
     /**
      * Classify the out-of-bag set for each tree.
      */
@@ -254,6 +514,50 @@ class RandomForest
       return deserialize_append( stream );
     }
 
+    /**
+     * Writes the forest as a flat model file (see ModelFile.h).
+     * @param stream The output stream.
+     * @param keys The feature names to store in the string table, or null
+     *    to leave it out.
+     * @return The output stream.
+     */
+    std::ostream & write_model(
+      std::ostream & stream,
+      const Dataset::KeyList * const keys = null(const Dataset::KeyList) ) const;
+
+    /**
+     * Replaces the forest with the trees of a flat model held in memory. The
+     * trees classify straight from the model's node arrays, so the memory must
+     * stay valid and unchanged until the forest is burned.
+     * @param data The model, 8-byte aligned.
+     * @param size The model size in bytes.
+     * @return True on success, false if the model is invalid or was written
+     *    on a machine of the other byte order.
+     */
+    bool load_model( const void * const data, const std::size_t size );
+
+    /**
+     * Replaces the forest with the trees of a flat model file, mapped into
+     * memory read-only. The mapping is released when the forest is burned.
+     * @param filename The model file.
+     * @return True on success, false if the file can't be mapped or is invalid.
+     */
+    bool map_model( const std::string & filename );
+
+    /**
+     * Reads the feature names from the string table of the loaded model.
+     * @param [out] keys Receives the feature names and their columns.
+     * @return True if the model has a string table, false otherwise.
+     */
+    bool read_model_keys( Dataset::KeyList & keys ) const;
+
+    /**
+     * Returns the number of columns a row needs for the loaded model to
+     * classify it. Loading rejects models that split on later columns.
+     * @return Column count, or 0 if no model is loaded.
+     */
+    unsigned int get_model_column_count( void ) const;
+
     /**
      * Returns the size of the forest.
      * @return Forest size.
@@ -264,7 +568,36 @@ class RandomForest
     }
 
   private:
-    Forest forest;        ///< The random forest generated.
+    /**
+     * Classify a block of rows, one tree at a time.
+     * @param dataset The rows to classify.
+     * @param begin First row of the block.
+     * @param end One past the last row of the block.
+     * @param votes Scratch vote counters, at least end - begin elements.
+     * @param [out] classifications Receives the classification of each row.
+     */
+    void classify_block(
+      const Dataset & dataset,
+      const unsigned int begin,
+      const unsigned int end,
+      unsigned int * const votes,
+      bool * const classifications ) const;
+
+    /**
+     * Unmaps the model file, if any, and forgets the loaded model.
+     */
+    void release_model( void );
+
+  private:
+    Forest forest;                ///< The random forest generated.
+    unsigned int histogram_bins;  ///< Bins per feature; 0 for exact splits.
+    unsigned int thread_count;    ///< Worker threads; 0 for one per processor.
+    uint64_t seed;                ///< Forest seed.
+    unsigned int stream;          ///< Random stream number.
+    std::ostream * progress;      ///< Progress output, if any.
+    const char * model_data;      ///< Loaded model, if any.
+    std::size_t model_size;       ///< Loaded model size in bytes.
+    void * model_map;             ///< Mapped model file, if any.
 
   private:
     friend class ut_RandomForest;   ///< For unit testing.
@@ -0,0 +1,103 @@
+/*
+ * RandomStream.h
+ */
+
+#ifndef __RandomStream_h__
+#define __RandomStream_h__
+
+#include <stdint.h>
+
+/**
+ * A fast, independent pseudo-random number stream (xoshiro256**). Every tree
+ * gets its own stream, derived from the forest seed, a stream number (the MPI
+ * rank) and the tree index, so trees can be grown concurrently without sharing
+ * generator state and the result doesn't depend on thread scheduling.
+ */
+class RandomStream
+{
+  public:
+    /**
+     * Constructor.
+     * @param seed The base seed.
+     * @param stream The stream number (e.g. MPI rank).
+     * @param index The index within the stream (e.g. tree index).
+     */
+    RandomStream(
+      const uint64_t seed,
+      const uint64_t stream = 0,
+      const uint64_t index = 0 )
+    {
+      // Hash the three inputs into one key, then expand it into the state.
+      uint64_t key = seed;
+      key = splitmix( key ) ^ stream;
+      key = splitmix( key ) ^ index;
+      for ( unsigned int word = 0; word < 4; ++word )
+      {
+        state[word] = splitmix( key );
+      }
+    }
+
+    /**
+     * Generate the next 64 random bits.
+     * @return Random value.
+     */
+    uint64_t next( void )
+    {
+      uint64_t result = rotate( state[1] * 5, 7 ) * 9;
+      uint64_t shifted = state[1] << 17;
+      state[2] ^= state[0];
+      state[3] ^= state[1];
+      state[1] ^= state[2];
+      state[0] ^= state[3];
+      state[2] ^= shifted;
+      state[3] = rotate( state[3], 45 );
+      return result;
+    }
+
+    /**
+     * Generate a random integer in [0, bound).
+     * @param bound Exclusive upper bound (> 0).
+     * @return Random value.
+     */
+    unsigned int uniform( const unsigned int bound )
+    {
+      // Scale the high 32 bits instead of taking a modulus.
+      return static_cast<unsigned int>( ((next() >> 32) * bound) >> 32 );
+    }
+
+    /**
+     * Generate a random real number in [0, 1).
+     * @return Random value.
+     */
+    double uniform_real( void )
+    {
+      return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+  private:
+    /**
+     * Rotate left.
+     */
+    static uint64_t rotate( const uint64_t value, const int bits )
+    {
+      return (value << bits) | (value >> (64 - bits));
+    }
+
+    /**
+     * Advance a splitmix64 generator and return its output.
+     * @param [in,out] x Generator state.
+     * @return Mixed value.
+     */
+    static uint64_t splitmix( uint64_t & x )
+    {
+      uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+    }
+
+  private:
+    uint64_t state[4];  ///< Generator state.
+};
+
+#endif
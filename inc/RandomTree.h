@@ -9,19 +9,49 @@
 #define __RandomTree_h__
 
 #include "Dataset.h"
+#include "HistogramReducer.h"
 #include "Node.h"
 
+#include <stdint.h>
+
 /**
  * Grows and classifies with a real-valued binary classification tree.
  */
 class RandomTree
 {
+  public:
+    /**
+     * Defines a node of a compiled tree. Compiled nodes are stored in
+     * breadth-first order in one array, and the two children of a split node
+     * are adjacent, so classification needs no pointers, virtual calls or
+     * allocation.
+     */
+    struct CompiledNode
+    {
+      uint32_t column;    ///< Split column, or LeafColumn for a leaf.
+      uint32_t child;     ///< Index of the <= child (the > child follows it),
+                          ///< or the classification (0 or 1) of a leaf.
+      double threshold;   ///< Split threshold.
+    };
+
+    /**
+     * Column value marking a compiled leaf node.
+     */
+    static const uint32_t LeafColumn = 0xFFFFFFFFu;
+
+    /**
+     * Defines a compiled tree.
+     */
+    typedef std::vector<CompiledNode> CompiledNodeVector;
+
   public:
     /**
      * Constructor.
      */
     RandomTree( void ) :
-      root( null(Node) )
+      root( null(Node) ),
+      compiled( null(CompiledNode) ),
+      compiled_count( 0 )
     {
       //
     }
@@ -46,6 +76,9 @@ class RandomTree
         delete root;
         root = null(Node);
       }
+      nodes.clear();
+      compiled = null(CompiledNode);
+      compiled_count = 0;
     }
 
     /**
@@ -74,19 +107,110 @@ class RandomTree
      * @param keys_per_node This is the number of keys per node to compare for
      *    splitting.
      * @param decision_column The column of the classification.
+     * @param random The random stream used to choose the keys at each node.
      */
     void grow_decision_tree(
       Dataset & data,
       const Dataset::KeyList & split_keys,
       const unsigned int keys_per_node,
-      const unsigned int decision_column);
+      const unsigned int decision_column,
+      RandomStream & random );
+
+    /**
+     * Grows the tree together with other processes, each holding a different
+     * shard of the rows. At every node the per-bin class histograms of the
+     * chosen keys are summed over all processes, so each one picks the same
+     * split and applies it to its own rows. The result is the tree a single
+     * process would grow from the binned union of the shards.
+     * @param data The local shard. Bins must be attached with set_bins(),
+     *    built from the same edges on every process.
+     * @param split_keys The valid keys to split from.
+     * @param keys_per_node This is the number of keys per node to compare for
+     *    splitting.
+     * @param decision_column The column of the classification.
+     * @param random The random stream used to choose the keys at each node.
+     *    Must produce the same sequence on every process.
+     * @param reducer Sums the histograms over all processes.
+     */
+    void grow_decision_tree_distributed(
+      Dataset & data,
+      const Dataset::KeyList & split_keys,
+      const unsigned int keys_per_node,
+      const unsigned int decision_column,
+      RandomStream & random,
+      HistogramReducer & reducer );
+
+    /**
+     * Packs the node tree into the compiled form used by classify(). Growing
+     * and deserializing compile automatically; call this after building a
+     * node tree by hand.
+     */
+    void compile( void );
+
+    /**
+     * Classify with compiled nodes stored elsewhere, such as a mapped model
+     * file, instead of growing or deserializing a node tree. The nodes are not
+     * copied and must stay valid until the tree is burned.
+     * @param external_nodes The compiled nodes in breadth-first order.
+     * @param count The number of nodes.
+     */
+    void attach( const CompiledNode * const external_nodes, const unsigned int count )
+    {
+      burn();
+      compiled = ( count > 0 ) ? external_nodes : null(CompiledNode);
+      compiled_count = count;
+    }
+
+    /**
+     * Returns the compiled nodes.
+     * @return Compiled nodes in breadth-first order, or null if there are none.
+     */
+    const CompiledNode * get_compiled_nodes( void ) const
+    {
+      return compiled;
+    }
+
+    /**
+     * Returns the number of compiled nodes.
+     * @return Node count.
+     */
+    unsigned int get_compiled_node_count( void ) const
+    {
+      return compiled_count;
+    }
 
     /**
-     * Classifies a row of data.
+     * Classifies a row of data using the compiled tree.
      * @param row A pointer to the data row.
      * @return The binary classification (true or false).
      */
-    bool classify( const double * const & row ) const;
+    bool classify( const double * const & row ) const
+    {
+      if ( compiled == null(CompiledNode) )
+      {
+        return false;
+      }
+      const CompiledNode * node = compiled;
+      while ( node->column != LeafColumn )
+      {
+        node = &compiled[node->child + ((row[node->column] > node->threshold) ? 1 : 0)];
+      }
+      return node->child != 0;
+    }
+
+    /**
+     * Classifies a range of dataset rows and counts the positive votes.
+     * @param data The dataset to classify (either layout).
+     * @param begin First row of the range.
+     * @param end One past the last row of the range.
+     * @param [in,out] votes Vote counters for the range; votes[row - begin] is
+     *    incremented for every row classified true.
+     */
+    void vote_batch(
+      const Dataset & data,
+      const unsigned int begin,
+      const unsigned int end,
+      unsigned int * const votes ) const;
 
     /**
      * Classifies the out-of-bag (OOB) dataset.
@@ -97,13 +221,21 @@ class RandomTree
     void classify_oob_set( double & oob_error ) const;
 
     /**
-     * Serializes the tree.
+     * Serializes the tree. An attached tree has no node tree, so one is
+     * rebuilt from its compiled nodes to write.
      * @param stream The output stream.
      * @return The output stream.
      */
     std::ostream & serialize( std::ostream & stream ) const
     {
-      return (root != null(Node)) ? Node::serialize(stream, *root) : stream;
+      if ( root != null(Node) )
+      {
+        return Node::serialize(stream, *root);
+      }
+      Node * rebuilt = decompile( 0, "" );
+      Node::serialize( stream, *rebuilt );
+      delete rebuilt;
+      return stream;
     }
 
     /**
@@ -118,6 +250,7 @@ class RandomTree
 
       // Deserialize.
       root = Node::deserialize(stream);
+      compile();
 
       // Done.
       return stream;
@@ -126,11 +259,12 @@ class RandomTree
   private:
     /**
      * Private helper method to grow the tree.
-     * @param data The dataset to use.
+     * @param data The dataset to use. Its rows are partitioned in place.
      * @param split_keys The valid keys to split from.
      * @param keys_per_node This is the number of keys per node to compare for
      *    splitting.
      * @param decision_column The column of the classification.
+     * @param random The random stream used to choose the keys at each node.
      * @param parent The parent node.
      * @param action The transition action.
      */
@@ -139,11 +273,65 @@ class RandomTree
       const Dataset::KeyList & split_keys,
       const unsigned int keys_per_node,
       const unsigned int decision_column,
+      RandomStream & random,
+      Node * const parent,
+      const std::string action );
+
+    /**
+     * Private helper method to grow the tree with other processes.
+     * @param data The local shard. Its rows are partitioned in place.
+     * @param split_keys The valid keys to split from.
+     * @param keys_per_node This is the number of keys per node to compare for
+     *    splitting.
+     * @param decision_column The column of the classification.
+     * @param random The random stream used to choose the keys at each node.
+     * @param reducer Sums the histograms over all processes.
+     * @param parent The parent node.
+     * @param action The transition action.
+     */
+    void _grow_decision_tree_distributed(
+      Dataset & data,
+      const Dataset::KeyList & split_keys,
+      const unsigned int keys_per_node,
+      const unsigned int decision_column,
+      RandomStream & random,
+      HistogramReducer & reducer,
       Node * const parent,
       const std::string action );
 
+    /**
+     * Choose a random subset of keys.
+     * @param split_keys The valid keys to split from.
+     * @param keys_per_node The number of keys to choose.
+     * @param random The random stream to choose with.
+     * @return The chosen keys.
+     */
+    static Dataset::KeyList choose_keys(
+      const Dataset::KeyList & split_keys,
+      const unsigned int keys_per_node,
+      RandomStream & random );
+
+    /**
+     * Rebuild the node tree below a compiled node. Without compiled nodes, it
+     * is a negative leaf, as classify() treats it.
+     * @param index The compiled node.
+     * @param action The action that led to the node.
+     * @return The rebuilt node and its children.
+     */
+    Node * decompile( const unsigned int index, const std::string & action ) const;
+
+    /**
+     * Attach a node below its parent, or make it the root.
+     * @param parent The parent node, or null.
+     * @param node The node to attach.
+     */
+    void attach_node( Node * const parent, Node * const node );
+
   private:
     Node * root;                        ///< Root node.
+    CompiledNodeVector nodes;           ///< Compiled tree, when owned.
+    const CompiledNode * compiled;      ///< Compiled nodes used to classify.
+    unsigned int compiled_count;        ///< Number of compiled nodes.
 
   private:
     friend class ut_RandomTree;         ///< For unit testing.
@@ -0,0 +1,78 @@
+/*
+ * RowReader.h
+ */
+
+#ifndef __RowReader_h__
+#define __RowReader_h__
+
+#include "Dataset.h"
+
+/**
+ * Reads the rows of a dataset file one at a time, or into a matrix. Every row
+ * holds the label in column 0 followed by the features.
+ */
+class RowReader
+{
+  public:
+    /**
+     * Destructor.
+     */
+    virtual ~RowReader( void )
+    {
+      //
+    }
+
+    /**
+     * Determine the number of matrix columns.
+     * @return The label plus the feature count.
+     */
+    virtual unsigned int column_count( void ) const = 0;
+
+    /**
+     * Count the rows. Doesn't move the read position.
+     * @return Row count.
+     */
+    virtual unsigned long count_rows( void ) const = 0;
+
+    /**
+     * Go back to the first row.
+     */
+    virtual void rewind( void ) = 0;
+
+    /**
+     * Read the next row.
+     * @param [out] row The column_count() values of the row.
+     * @return False if there are no more rows.
+     */
+    virtual bool next_row( double * const row ) = 0;
+
+    /**
+     * Skip the next row without reading it.
+     * @return False if there are no more rows.
+     */
+    virtual bool skip_row( void ) = 0;
+
+    /**
+     * Read rows into a matrix with column_count() columns, starting at the
+     * next row.
+     * @param matrix The matrix to fill, from its first row.
+     * @return The number of rows read, at most the matrix row count.
+     */
+    virtual unsigned long read( Dataset::RealMatrix & matrix ) = 0;
+
+    /**
+     * Read the rows chosen from the next keep.size() rows into a matrix with
+     * column_count() columns. Rows that aren't kept are skipped without being
+     * read.
+     * @param matrix The matrix to fill with the kept rows, from its first row.
+     *      Must have a row for every kept row.
+     * @param keep Whether to keep each of the next rows.
+     * @return The number of rows passed, kept or not. Less than keep.size()
+     *      only if the rows ran out.
+     */
+    virtual unsigned long read_selected(
+      Dataset::RealMatrix & matrix,
+      const std::vector<bool> & keep ) = 0;
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Schema.h
+ */
+
+#ifndef __Schema_h__
+#define __Schema_h__
+
+#include "ColumnFile.h"
+#include "Dataset.h"
+#include "TextLoader.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Describes the layout of a text dataset: the delimiter, which fields hold the
+ * ID and the label, how many matrix columns to load and what they are called.
+ * A schema can be read from a sidecar file, completed from the data file itself
+ * and written out again, e.g. to send it to other processes.
+ *
+ * The sidecar holds name=value lines. Blank lines and lines starting with '#'
+ * are ignored, and settings left out keep their current values:
+ *
+ *    delimiter=tab           the field delimiter: tab or a single character
+ *    id-column=0             the field holding the row ID, or none
+ *    label-column=1          the field holding the class label
+ *    columns=107             the label plus the features to load, 0 for all
+ *    header=1                1 if the first line names the fields
+ *    positive-max=1          labels up to this are stored as 1 and the rest
+ *                            as 0, or none to store them as they are
+ *    name=class              the name of the next matrix column, label first;
+ *                            one line per column
+ */
+class Schema
+{
+  public:
+    /**
+     * Constructor. Defaults to tab-separated fields, no ID column, the label
+     * in the first field, every field loaded, no header, labels stored as
+     * they are and no names.
+     */
+    Schema( void );
+
+    /**
+     * Read the settings in a sidecar file.
+     * @param filename The sidecar to read.
+     * @return False if the file can't be read or has a bad line.
+     */
+    bool read( const std::string & filename );
+
+    /**
+     * Read settings in sidecar format.
+     * @param stream The settings.
+     * @return False if there is a bad line.
+     */
+    bool read( std::istream & stream );
+
+    /**
+     * Write every setting in sidecar format.
+     * @param stream The stream to write to.
+     */
+    void write( std::ostream & stream ) const;
+
+    /**
+     * Set up a loader to read files of this schema.
+     * @param loader The loader, before it opens a file.
+     */
+    void configure( TextLoader & loader ) const;
+
+    /**
+     * Describe how files of this schema are parsed, to record in a column
+     * file converted from one.
+     * @return Source settings.
+     */
+    DataFile::Source source( void ) const;
+
+    /**
+     * Determine if a column file was converted from text parsed the way this
+     * schema parses it, i.e. if it can stand in for the text.
+     * @param file The open column file.
+     * @return True if the delimiter, ID and label fields, header setting,
+     * label mapping and column count (if set) all match.
+     */
+    bool matches( const ColumnFile & file ) const;
+
+    /**
+     * Fill in the column count, if not set, and any missing names from an open
+     * file. Names come from the header, or else are class, f1, f2, ...
+     * @param loader A loader set up with configure() and opened.
+     */
+    void infer( const TextLoader & loader );
+
+    /**
+     * Fill in the column count, if not set, and any missing names from an open
+     * column file.
+     * @param file The open column file.
+     */
+    void infer( const ColumnFile & file );
+
+    /**
+     * Name the matrix columns.
+     * @param [out] keys The column of every name.
+     */
+    void name_keys( Dataset::KeyList & keys ) const;
+
+    /**
+     * Set the field delimiter.
+     * @param delimiter The delimiter, e.g. '\t' or ','.
+     */
+    void set_delimiter( const char delimiter )
+    {
+      this->delimiter = delimiter;
+    }
+
+    /**
+     * Set the field holding the row ID.
+     * @param column The field index, or TextLoader::NoColumn.
+     */
+    void set_id_column( const unsigned int column )
+    {
+      id_column = column;
+    }
+
+    /**
+     * Set the field holding the label.
+     * @param column The field index.
+     */
+    void set_label_column( const unsigned int column )
+    {
+      label_column = column;
+    }
+
+    /**
+     * Set the number of matrix columns.
+     * @param columns The label plus the feature count, or 0 for every field.
+     */
+    void set_column_count( const unsigned int columns )
+    {
+      this->columns = columns;
+    }
+
+    /**
+     * Set whether the first line is a header naming the fields.
+     * @param header True if the file has a header line.
+     */
+    void set_header( const bool header )
+    {
+      this->header = header;
+    }
+
+    /**
+     * Set how labels are stored.
+     * @param threshold True to store labels <= positive_max as 1 and the rest
+     *      as 0, false to store them as they are.
+     * @param positive_max The largest label of the positive class.
+     */
+    void set_label_threshold( const bool threshold, const double positive_max )
+    {
+      label_threshold = threshold;
+      this->positive_max = threshold ? positive_max : 0.0;
+    }
+
+    /**
+     * Return the number of matrix columns.
+     * @return The label plus the feature count, or 0 if not known yet.
+     */
+    unsigned int column_count( void ) const
+    {
+      return columns;
+    }
+
+    /**
+     * Return the number of features.
+     * @return Feature count, or 0 if not known yet.
+     */
+    unsigned int feature_count( void ) const
+    {
+      return ( columns > 0 ) ? columns - 1 : 0;
+    }
+
+    /**
+     * Return the names of the matrix columns, the label first.
+     * @return Column names.
+     */
+    const std::vector<std::string> & get_names( void ) const
+    {
+      return names;
+    }
+
+  private:
+    /**
+     * Name the columns that have no name yet.
+     * @param column_names Names found in the file, empty ones left out.
+     */
+    void complete_names( const std::vector<std::string> & column_names );
+
+  private:
+    char delimiter;                   ///< Field delimiter.
+    unsigned int id_column;           ///< ID field, or TextLoader::NoColumn.
+    unsigned int label_column;        ///< Label field.
+    unsigned int columns;             ///< Matrix columns, or 0 for every field.
+    bool header;                      ///< First line names the fields.
+    bool label_threshold;             ///< Labels stored as 1 up to positive_max.
+    double positive_max;              ///< Largest positive label, or 0.
+    std::vector<std::string> names;   ///< Column names, the label first.
+};
+
+#endif
@@ -0,0 +1,469 @@
+/*
+ * TextLoader.h
+ */
+
+#ifndef __TextLoader_h__
+#define __TextLoader_h__
+
+#include "Dataset.h"
+#include "RowReader.h"
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Reads delimited text data (TSV, CSV) into matrix rows. The file is mapped
+ * and every field is parsed in place with std::from_chars, so there is no
+ * allocation per line or per field. Each row becomes the (mapped) label
+ * followed by the other fields in file order, leaving out the ID column. A
+ * delimiter at the end of a line doesn't start another field, and empty lines
+ * are skipped. With set_header(), the first line names the fields and isn't
+ * read as a row.
+ *
+ * With more than one thread, count_rows() and read() split the text into
+ * chunks that start at line boundaries. read() counts the rows of every chunk
+ * in parallel, which places each chunk in the matrix, and then parses the
+ * chunks in parallel straight into their rows. read_selected() finds the line
+ * ends of its rows first and parses only the kept lines, an even share per
+ * thread.
+ */
+class TextLoader : public RowReader
+{
+  public:
+    /**
+     * Maps a label field to the value stored in the label column.
+     */
+    typedef double (*LabelFunction)( const double value );
+
+    /**
+     * Column index meaning "no such column".
+     */
+    static const unsigned int NoColumn = 0xFFFFFFFFu;
+
+    /**
+     * Smallest chunk worth a thread of its own, in bytes.
+     */
+    static const std::size_t MinChunkBytes = 64 * 1024;
+
+  private:
+    /**
+     * Defines a run of whole lines handled by one thread.
+     */
+    struct Chunk
+    {
+      const char * begin;           ///< First character.
+      const char * end;             ///< One past the last character.
+      const char * next;            ///< Where parsing stopped.
+      unsigned long rows;           ///< Non-empty lines in the chunk.
+      unsigned long first_row;      ///< Matrix row of the first line.
+      unsigned long parse_rows;     ///< Lines to parse.
+    };
+
+    /**
+     * Defines a line found but not yet parsed.
+     */
+    struct Line
+    {
+      const char * begin;           ///< First character.
+      const char * end;             ///< One past the last character.
+    };
+
+    /**
+     * Defines a row counting task. Each task index counts one chunk.
+     */
+    class ChunkCountTask : public ThreadPool::Task
+    {
+      public:
+        /**
+         * Constructor.
+         */
+        ChunkCountTask( const TextLoader & loader, std::vector<Chunk> & chunks ) :
+          loader(loader),
+          chunks(chunks)
+        {
+          //
+        }
+
+        /**
+         * Count the rows of one chunk.
+         * @param chunk_index The index of the chunk.
+         */
+        virtual void run( const unsigned int chunk_index )
+        {
+          Chunk & chunk = chunks[chunk_index];
+          chunk.rows = loader.count_lines( chunk.begin, chunk.end );
+        }
+
+      private:
+        const TextLoader & loader;
+        std::vector<Chunk> & chunks;
+    };
+
+    /**
+     * Defines a parsing task. Each task index parses one chunk into its rows
+     * of the matrix.
+     */
+    class ChunkParseTask : public ThreadPool::Task
+    {
+      public:
+        /**
+         * Constructor.
+         */
+        ChunkParseTask(
+          const TextLoader & loader,
+          std::vector<Chunk> & chunks,
+          Dataset::RealMatrix & matrix ) :
+            loader(loader),
+            chunks(chunks),
+            matrix(matrix)
+        {
+          //
+        }
+
+        /**
+         * Parse one chunk.
+         * @param chunk_index The index of the chunk.
+         */
+        virtual void run( const unsigned int chunk_index )
+        {
+          loader.parse_chunk( chunks[chunk_index], matrix );
+        }
+
+      private:
+        const TextLoader & loader;
+        std::vector<Chunk> & chunks;
+        Dataset::RealMatrix & matrix;
+    };
+
+    /**
+     * Defines a parsing task over lines already found. Each task index parses
+     * an even share of the lines into their rows of the matrix.
+     */
+    class LineParseTask : public ThreadPool::Task
+    {
+      public:
+        /**
+         * Constructor.
+         */
+        LineParseTask(
+          const TextLoader & loader,
+          const std::vector<Line> & lines,
+          const unsigned int task_count,
+          Dataset::RealMatrix & matrix ) :
+            loader(loader),
+            lines(lines),
+            task_count(task_count),
+            matrix(matrix)
+        {
+          //
+        }
+
+        /**
+         * Parse one share of the lines.
+         * @param task_index The index of the share.
+         */
+        virtual void run( const unsigned int task_index )
+        {
+          unsigned long first = lines.size() * task_index / task_count;
+          unsigned long last = lines.size() * (task_index + 1) / task_count;
+          loader.parse_lines( lines, first, last, matrix );
+        }
+
+      private:
+        const TextLoader & loader;
+        const std::vector<Line> & lines;
+        const unsigned int task_count;
+        Dataset::RealMatrix & matrix;
+    };
+
+  public:
+    /**
+     * Constructor. Defaults to tab-separated fields, no ID column, the label
+     * in the first field and no label mapping.
+     */
+    TextLoader( void );
+
+    /**
+     * Destructor. Unmaps the file.
+     */
+    virtual ~TextLoader( void )
+    {
+      close();
+    }
+
+    /**
+     * Map a file and rewind to its first line.
+     * @param filename The file to read.
+     * @return True if the file was mapped.
+     */
+    bool open( const std::string & filename );
+
+    /**
+     * Unmap the file.
+     */
+    void close( void );
+
+    /**
+     * Set the field delimiter.
+     * @param delimiter The delimiter, e.g. '\t' or ','.
+     */
+    void set_delimiter( const char delimiter )
+    {
+      this->delimiter = delimiter;
+    }
+
+    /**
+     * Set the field holding the row ID, which is not loaded.
+     * @param column The field index, or NoColumn.
+     */
+    void set_id_column( const unsigned int column )
+    {
+      id_column = column;
+    }
+
+    /**
+     * Set the field holding the label, which is loaded into column 0.
+     * @param column The field index.
+     */
+    void set_label_column( const unsigned int column )
+    {
+      label_column = column;
+    }
+
+    /**
+     * Set the function applied to every label.
+     * @param function The mapping, or null to keep the labels as they are.
+     */
+    void set_label_function( const LabelFunction function )
+    {
+      label_function = function;
+    }
+
+    /**
+     * Map every label to the binary class: 1 if it is <= positive_max and 0
+     * otherwise. Takes precedence over any label function.
+     * @param threshold True to map the labels, false to leave them to the
+     *      label function.
+     * @param positive_max The largest label of the positive class.
+     */
+    void set_label_threshold( const bool threshold, const double positive_max )
+    {
+      label_threshold = threshold;
+      this->positive_max = positive_max;
+    }
+
+    /**
+     * Fix the number of matrix columns. Fields past the last column are
+     * ignored.
+     * @param columns The label plus the feature count, or 0 to take it from
+     *      the first line.
+     */
+    void set_column_count( const unsigned int columns )
+    {
+      this->columns = columns;
+    }
+
+    /**
+     * Set whether the first line is a header naming the fields. Takes effect
+     * at the next open().
+     * @param header True if the file has a header line.
+     */
+    void set_header( const bool header )
+    {
+      this->header = header;
+    }
+
+    /**
+     * Name the matrix columns from the header line: the label field first,
+     * then the other fields in file order, leaving out the ID field.
+     * @param [out] names The column_count() names, or none without a header.
+     *      Columns past the last header field are unnamed.
+     */
+    void column_names( std::vector<std::string> & names ) const;
+
+    /**
+     * Set the number of threads used by count_rows() and read().
+     * @param threads Thread count, or 0 for one per processor. Defaults to 1.
+     */
+    void set_thread_count( const unsigned int threads )
+    {
+      thread_count = threads;
+    }
+
+    /**
+     * Determine the number of matrix columns: the count set with
+     * set_column_count(), or else from the first line, header or not.
+     * @return The label plus the feature count, 0 if there are no lines.
+     */
+    virtual unsigned int column_count( void ) const;
+
+    /**
+     * Count the rows in the file. Doesn't move the read position.
+     * @return The number of non-empty lines after any header.
+     */
+    virtual unsigned long count_rows( void ) const;
+
+    /**
+     * Go back to the first line after any header.
+     */
+    virtual void rewind( void )
+    {
+      position = body;
+    }
+
+    /**
+     * Parse the next row. Missing fields are 0 and extra fields are ignored.
+     * @param [out] row The column_count() values of the row.
+     * @return False if there are no more rows.
+     */
+    virtual bool next_row( double * const row );
+
+    /**
+     * Skip the next row without parsing it.
+     * @return False if there are no more rows.
+     */
+    virtual bool skip_row( void );
+
+    /**
+     * Parse rows into a matrix with column_count() columns, starting at the
+     * next row. Reads the text in windows sized to the rows still wanted, so
+     * filling a small matrix doesn't scan the rest of the file.
+     * @param matrix The matrix to fill, from its first row.
+     * @return The number of rows read, at most the matrix row count.
+     */
+    virtual unsigned long read( Dataset::RealMatrix & matrix );
+
+    /**
+     * Parse the rows chosen from the next keep.size() rows into a matrix with
+     * column_count() columns. Only the kept lines are parsed; the rest are
+     * only scanned for their ends.
+     * @param matrix The matrix to fill with the kept rows, from its first row.
+     * @param keep Whether to keep each of the next rows.
+     * @return The number of rows passed, kept or not.
+     */
+    virtual unsigned long read_selected(
+      Dataset::RealMatrix & matrix,
+      const std::vector<bool> & keep );
+
+  private:
+    /**
+     * Find the next non-empty line after a position.
+     * @param [in,out] next The start of the search, moved past the line.
+     * @param [out] begin The first character of the line.
+     * @param [out] end One past the last character, excluding any "\r\n".
+     * @return False if there are no more lines.
+     */
+    bool find_line( const char * & next, const char * & begin, const char * & end ) const
+    {
+      return find_line( next, data + size, begin, end );
+    }
+
+    /**
+     * Find the next non-empty line after a position, up to a limit.
+     * @param [in,out] next The start of the search, moved past the line.
+     * @param limit One past the last character to search.
+     * @param [out] begin The first character of the line.
+     * @param [out] end One past the last character, excluding any "\r\n".
+     * @return False if there are no more lines before the limit.
+     */
+    bool find_line(
+      const char * & next,
+      const char * const limit,
+      const char * & begin,
+      const char * & end ) const;
+
+    /**
+     * Find the next non-empty line and move past it.
+     * @param [out] begin The first character of the line.
+     * @param [out] end One past the last character, excluding any "\r\n".
+     * @return False if there are no more lines.
+     */
+    bool next_line( const char * & begin, const char * & end );
+
+    /**
+     * Parse one line into a row.
+     * @param begin The first character of the line.
+     * @param end One past the last character.
+     * @param [out] row The column_count() values of the row.
+     */
+    void parse_line( const char * begin, const char * const end, double * const row ) const;
+
+    /**
+     * Count the non-empty lines in a range.
+     * @param begin The first character, at the start of a line.
+     * @param end One past the last character, at the end of a line.
+     * @return Line count.
+     */
+    unsigned long count_lines( const char * begin, const char * const end ) const;
+
+    /**
+     * Split a range into chunks at line boundaries.
+     * @param begin The first character, at the start of a line.
+     * @param bytes The number of bytes to split. The last chunk runs on to the
+     *      end of its line.
+     * @param chunk_count The number of chunks wanted.
+     * @param [out] chunks The chunks, in order. Empty chunks are left out.
+     */
+    void split( const char * const begin, const std::size_t bytes,
+      const unsigned int chunk_count, std::vector<Chunk> & chunks ) const;
+
+    /**
+     * Parse the first parse_rows lines of a chunk into the matrix, from row
+     * first_row, and set where parsing stopped.
+     * @param [in,out] chunk The chunk.
+     * @param matrix The matrix to fill.
+     */
+    void parse_chunk( Chunk & chunk, Dataset::RealMatrix & matrix ) const;
+
+    /**
+     * Parse lines first to last-1 into the matrix rows of the same index.
+     * @param lines The lines.
+     * @param first The first line to parse.
+     * @param last One past the last line to parse.
+     * @param matrix The matrix to fill.
+     */
+    void parse_lines(
+      const std::vector<Line> & lines,
+      const unsigned long first,
+      const unsigned long last,
+      Dataset::RealMatrix & matrix ) const;
+
+    /**
+     * Determine the number of threads to use.
+     * @return Thread count.
+     */
+    unsigned int threads( void ) const
+    {
+      return ( thread_count > 0 ) ? thread_count : ThreadPool::hardware_concurrency();
+    }
+
+    /**
+     * Parse a number, as strtod() would. An empty field is 0.
+     * @param begin The first character of the field.
+     * @param end One past the last character of the field.
+     * @return The value.
+     */
+    static double parse_field( const char * begin, const char * const end );
+
+  private:
+    const char * data;              ///< The mapped file.
+    std::size_t size;               ///< File size in bytes.
+    const char * body;              ///< Start of the first row, past any header.
+    const char * position;          ///< Start of the next line.
+    unsigned int fields;            ///< Fields in the first line.
+    bool header;                    ///< First line names the fields.
+    std::vector<std::string> field_names; ///< Header fields, in file order.
+    unsigned int columns;           ///< Fixed column count, or 0.
+    char delimiter;                 ///< Field delimiter.
+    unsigned int id_column;         ///< ID field, or NoColumn.
+    unsigned int label_column;      ///< Label field.
+    LabelFunction label_function;   ///< Label mapping, or null.
+    bool label_threshold;           ///< Map labels to 1 up to positive_max, else 0.
+    double positive_max;            ///< Largest positive label, if thresholded.
+    unsigned int thread_count;      ///< Parsing threads, 0 for one per processor.
+    std::size_t line_bytes;         ///< Length of the first row, with its newline.
+};
+
+#endif
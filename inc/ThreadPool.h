@@ -0,0 +1,203 @@
+/*
+ * ThreadPool.h
+ */
+
+#ifndef __ThreadPool_h__
+#define __ThreadPool_h__
+
+#include <deque>
+#include <vector>
+
+#include <pthread.h>
+
+/**
+ * Runs a set of indexed tasks on a pool of threads. Task indices are dealt
+ * round-robin into a queue per thread. Each thread works through its own queue
+ * and, once it is empty, steals from the other queues, so a few long tasks
+ * don't leave the other threads idle.
+ */
+class ThreadPool
+{
+  public:
+    /**
+     * Interface for the work run by the pool.
+     */
+    class Task
+    {
+      public:
+        /**
+         * Destructor.
+         */
+        virtual ~Task( void )
+        {
+          //
+        }
+
+        /**
+         * Run one unit of work. Called concurrently from the pool threads.
+         * @param index The task index.
+         */
+        virtual void run( const unsigned int index ) = 0;
+    };
+
+  private:
+    /**
+     * Defines a thread-safe double-ended queue of task indices. The owning
+     * thread takes from the back, other threads steal from the front.
+     */
+    class WorkQueue
+    {
+      public:
+        /**
+         * Constructor.
+         */
+        WorkQueue( void )
+        {
+          pthread_mutex_init(&mutex, NULL);
+        }
+
+        /**
+         * Destructor.
+         */
+        ~WorkQueue( void )
+        {
+          pthread_mutex_destroy(&mutex);
+        }
+
+        /**
+         * Add a task index.
+         * @param index The task index.
+         */
+        void push( const unsigned int index )
+        {
+          pthread_mutex_lock(&mutex);
+          indices.push_back(index);
+          pthread_mutex_unlock(&mutex);
+        }
+
+        /**
+         * Take the most recently added task index (owner side).
+         * @param [out] index The task index.
+         * @return True if an index was taken, false if the queue is empty.
+         */
+        bool pop( unsigned int & index )
+        {
+          pthread_mutex_lock(&mutex);
+          bool found = !indices.empty();
+          if ( found )
+          {
+            index = indices.back();
+            indices.pop_back();
+          }
+          pthread_mutex_unlock(&mutex);
+          return found;
+        }
+
+        /**
+         * Take the oldest task index (thief side).
+         * @param [out] index The task index.
+         * @return True if an index was taken, false if the queue is empty.
+         */
+        bool steal( unsigned int & index )
+        {
+          pthread_mutex_lock(&mutex);
+          bool found = !indices.empty();
+          if ( found )
+          {
+            index = indices.front();
+            indices.pop_front();
+          }
+          pthread_mutex_unlock(&mutex);
+          return found;
+        }
+
+      private:
+        pthread_mutex_t mutex;              ///< Access mutex.
+        std::deque<unsigned int> indices;   ///< Queued task indices.
+    };
+
+    /**
+     * Defines a pool thread.
+     */
+    struct Worker
+    {
+      ThreadPool * pool;  ///< The owning pool.
+      unsigned int id;    ///< Worker (and queue) index.
+      pthread_t thread;   ///< The thread.
+      bool started;       ///< Whether the thread was created.
+    };
+
+  public:
+    /**
+     * Constructor.
+     * @param thread_count Number of threads, or 0 for one per processor.
+     */
+    ThreadPool( const unsigned int thread_count );
+
+    /**
+     * Destructor. Waits for running tasks to finish.
+     */
+    ~ThreadPool( void );
+
+    /**
+     * Determine the number of threads.
+     * @return Thread count.
+     */
+    unsigned int get_thread_count( void ) const
+    {
+      return workers.size();
+    }
+
+    /**
+     * Start running tasks 0 to task_count-1 and return immediately. The
+     * threads that start take the work of any that can't be created; if none
+     * can, the tasks run on the calling thread before this returns.
+     * @param task The work to run. Must stay valid until join() returns.
+     * @param task_count The number of task indices.
+     */
+    void start( Task & task, const unsigned int task_count );
+
+    /**
+     * Wait for all tasks started by start() to finish.
+     */
+    void join( void );
+
+    /**
+     * Run tasks 0 to task_count-1 and wait for them to finish.
+     * @param task The work to run.
+     * @param task_count The number of task indices.
+     */
+    void run( Task & task, const unsigned int task_count )
+    {
+      start( task, task_count );
+      join();
+    }
+
+    /**
+     * Determine the number of online processors.
+     * @return Processor count (at least 1).
+     */
+    static unsigned int hardware_concurrency( void );
+
+  private:
+    /**
+     * Thread routing function.
+     * @param worker_pointer The pointer to the worker to execute.
+     * @return Null pointer (unused, required for interface).
+     */
+    static void * route( void * worker_pointer );
+
+    /**
+     * Run tasks until all queues are empty.
+     * @param worker_id The worker index.
+     */
+    void work( const unsigned int worker_id );
+
+  private:
+    std::vector<Worker> workers;      ///< Pool threads.
+    std::vector<WorkQueue*> queues;   ///< Task queue per thread.
+    Task * task;                      ///< The running task, if any.
+    bool running;                     ///< Whether threads need joining.
+};
+
+#endif
@@ -0,0 +1,399 @@
+/*
+ * ColumnFile.cpp
+ */
+
+#include "ColumnFile.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+ColumnFile::ColumnFile( void ) :
+  map( null(void) ),
+  map_size( 0 ),
+  matrix( null(Dataset::RealMatrix) ),
+  label_column( 0 ),
+  next( 0 )
+{
+  memset( &source, 0, sizeof(source) );
+}
+
+//------------------------------------------------------------------------------
+
+bool ColumnFile::write(
+  const std::string & filename,
+  const Dataset::RealMatrix & matrix,
+  const Dataset::KeyList & keys,
+  const unsigned int label_column,
+  const DataFile::Source & source )
+{
+  DataFile::Header header;
+  string names;
+  describe(
+    matrix.row_count(), matrix.column_count(), keys, label_column, source,
+    header, names );
+
+  // Write.
+  ofstream stream( filename.c_str(), ios_base::out | ios_base::binary );
+  stream.write( reinterpret_cast<const char*>(&header), sizeof(header) );
+  stream.write( names.data(), names.size() );
+  string padding( header.column_offset - header.name_table_offset - names.size(), '\0' );
+  stream.write( padding.data(), padding.size() );
+  vector<double> column_buffer( matrix.row_count() );
+  for ( unsigned int column = 0; column < matrix.column_count(); ++column )
+  {
+    for ( unsigned int row = 0; row < matrix.row_count(); ++row )
+    {
+      column_buffer[row] = matrix.get( row, column );
+    }
+    stream.write(
+      reinterpret_cast<const char*>(&column_buffer[0]),
+      column_buffer.size() * sizeof(double) );
+  }
+  stream.close();
+  return !stream.fail();
+}
+
+//------------------------------------------------------------------------------
+
+bool ColumnFile::convert(
+  RowReader & reader,
+  const std::string & filename,
+  const Dataset::KeyList & keys,
+  const DataFile::Source & source )
+{
+  reader.rewind();
+  unsigned long row_count = reader.count_rows();
+  unsigned int column_count = reader.column_count();
+  DataFile::Header header;
+  string names;
+  describe( row_count, column_count, keys, 0, source, header, names );
+
+  stringstream temporary;
+  temporary << filename << "." << getpid() << ".tmp";
+  int descriptor = ::open( temporary.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+  if ( descriptor < 0 )
+  {
+    return false;
+  }
+
+  // The header and names, then each block of rows into its place in every
+  // column. The file is sized first, so the padding reads back as zeros.
+  uint64_t file_size = header.column_offset + row_count * column_count * sizeof(double);
+  bool written =
+    ( ftruncate( descriptor, file_size ) == 0 ) &&
+    write_at( descriptor, &header, sizeof(header), 0 ) &&
+    write_at( descriptor, names.data(), names.size(), header.name_table_offset );
+  Dataset::RealMatrix block( ConvertBlockRows, column_count );
+  vector<double> column_buffer( ConvertBlockRows );
+  unsigned long first_row = 0;
+  while ( written && (first_row < row_count) )
+  {
+    unsigned long block_rows = reader.read( block );
+    if ( (block_rows == 0) || (first_row + block_rows > row_count) )
+    {
+      written = false;
+      break;
+    }
+    for ( unsigned int column = 0; column < column_count; ++column )
+    {
+      for ( unsigned long row = 0; row < block_rows; ++row )
+      {
+        column_buffer[row] = block.at( row, column );
+      }
+      uint64_t offset =
+        header.column_offset + (column * row_count + first_row) * sizeof(double);
+      written = written &&
+        write_at( descriptor, &column_buffer[0], block_rows * sizeof(double), offset );
+    }
+    first_row += block_rows;
+  }
+  written = ( ::close( descriptor ) == 0 ) && written;
+
+  if ( !written )
+  {
+    remove( temporary.str().c_str() );
+    return false;
+  }
+  return rename( temporary.str().c_str(), filename.c_str() ) == 0;
+}
+
+//------------------------------------------------------------------------------
+
+void ColumnFile::describe(
+  const unsigned long row_count,
+  const unsigned int column_count,
+  const Dataset::KeyList & keys,
+  const unsigned int label_column,
+  const DataFile::Source & source,
+  DataFile::Header & header,
+  std::string & names )
+{
+  // Name table.
+  names.clear();
+  for (
+    Dataset::KeyList::const_iterator iter = keys.begin();
+    iter != keys.end(); ++iter )
+  {
+    uint32_t column = iter->second;
+    uint32_t length = iter->first.size();
+    names.append( reinterpret_cast<const char*>(&column), sizeof(column) );
+    names.append( reinterpret_cast<const char*>(&length), sizeof(length) );
+    names.append( iter->first );
+  }
+
+  // Header, with the column blocks aligned after the names.
+  memset( &header, 0, sizeof(header) );
+  memcpy( header.magic, DataFile::Magic, sizeof(header.magic) );
+  header.byte_order = DataFile::ByteOrderMark;
+  header.version = DataFile::Version;
+  header.column_count = column_count;
+  header.label_column = label_column;
+  header.row_count = row_count;
+  header.name_table_offset = sizeof(header);
+  header.name_table_size = names.size();
+  header.column_offset =
+    (header.name_table_offset + header.name_table_size + DataFile::ColumnAlignment - 1)
+    / DataFile::ColumnAlignment * DataFile::ColumnAlignment;
+  header.source = source;
+}
+
+//------------------------------------------------------------------------------
+
+bool ColumnFile::write_at(
+  const int descriptor,
+  const void * const data,
+  const std::size_t size,
+  const uint64_t offset )
+{
+  const char * bytes = reinterpret_cast<const char*>(data);
+  std::size_t done = 0;
+  while ( done < size )
+  {
+    ssize_t count = pwrite( descriptor, bytes + done, size - done, offset + done );
+    if ( count <= 0 )
+    {
+      return false;
+    }
+    done += count;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool ColumnFile::open( const std::string & filename )
+{
+  close();
+
+  int descriptor = ::open( filename.c_str(), O_RDONLY );
+  if ( descriptor < 0 )
+  {
+    return false;
+  }
+  struct stat status;
+  if ( (fstat(descriptor, &status) != 0) || (status.st_size <= 0) )
+  {
+    ::close( descriptor );
+    return false;
+  }
+  map_size = status.st_size;
+  map = mmap( null(void), map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0 );
+  ::close( descriptor );
+  if ( map == MAP_FAILED )
+  {
+    map = null(void);
+    map_size = 0;
+    return false;
+  }
+
+  if ( !load() )
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void ColumnFile::close( void )
+{
+  delete matrix;
+  matrix = null(Dataset::RealMatrix);
+  if ( map != null(void) )
+  {
+    munmap( map, map_size );
+  }
+  map = null(void);
+  map_size = 0;
+  keys.clear();
+  label_column = 0;
+  memset( &source, 0, sizeof(source) );
+  next = 0;
+}
+
+//------------------------------------------------------------------------------
+
+bool ColumnFile::load( void )
+{
+  // Check the header.
+  const char * bytes = reinterpret_cast<const char*>(map);
+  DataFile::Header header;
+  if ( map_size < sizeof(header) )
+  {
+    return false;
+  }
+  memcpy( &header, bytes, sizeof(header) );
+  if ( (memcmp(header.magic, DataFile::Magic, sizeof(header.magic)) != 0) ||
+       (header.byte_order != DataFile::ByteOrderMark) ||
+       (header.version != DataFile::Version) ||
+       (header.row_count > 0xFFFFFFFFull) ||
+       (header.label_column >= header.column_count) )
+  {
+    return false;
+  }
+
+  // Check the blocks fit.
+  uint64_t column_bytes = header.row_count * header.column_count * sizeof(double);
+  if ( (header.column_offset % sizeof(double) != 0) ||
+       (header.column_offset > map_size) ||
+       (column_bytes / sizeof(double) / header.column_count != header.row_count) ||
+       (column_bytes > map_size - header.column_offset) ||
+       (header.name_table_offset > map_size) ||
+       (header.name_table_size > map_size - header.name_table_offset) )
+  {
+    return false;
+  }
+
+  // Read the names.
+  const char * record = bytes + header.name_table_offset;
+  const char * end = record + header.name_table_size;
+  while ( end - record >= 2 * static_cast<ptrdiff_t>(sizeof(uint32_t)) )
+  {
+    uint32_t column = 0;
+    uint32_t length = 0;
+    memcpy( &column, record, sizeof(column) );
+    memcpy( &length, record + sizeof(column), sizeof(length) );
+    record += sizeof(column) + sizeof(length);
+    if ( length > static_cast<size_t>(end - record) )
+    {
+      return false;
+    }
+    keys[string(record, length)] = column;
+    record += length;
+  }
+
+  label_column = header.label_column;
+  source = header.source;
+  matrix = new Dataset::RealMatrix(
+    reinterpret_cast<double*>(reinterpret_cast<char*>(map) + header.column_offset),
+    header.row_count, header.column_count, Dataset::ColumnMajor );
+  matrix->set_mapped( true );
+  next = 0;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int ColumnFile::column_count( void ) const
+{
+  return ( matrix != null(Dataset::RealMatrix) ) ? matrix->column_count() : 0;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned long ColumnFile::count_rows( void ) const
+{
+  return ( matrix != null(Dataset::RealMatrix) ) ? matrix->row_count() : 0;
+}
+
+//------------------------------------------------------------------------------
+
+bool ColumnFile::next_row( double * const row )
+{
+  if ( next >= count_rows() )
+  {
+    return false;
+  }
+  matrix->copy_row( next++, row );
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool ColumnFile::skip_row( void )
+{
+  if ( next >= count_rows() )
+  {
+    return false;
+  }
+  ++next;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned long ColumnFile::read( Dataset::RealMatrix & destination )
+{
+  unsigned long rows = count_rows() - next;
+  if ( rows > destination.row_count() )
+  {
+    rows = destination.row_count();
+  }
+
+  // Copy a column at a time, reading each block front to back.
+  for ( unsigned int column = 0; column < column_count(); ++column )
+  {
+    const double * source = matrix->column_data( column ) + next;
+    for ( unsigned long row = 0; row < rows; ++row )
+    {
+      destination.at( row, column ) = source[row];
+    }
+  }
+  next += rows;
+  return rows;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned long ColumnFile::read_selected(
+  Dataset::RealMatrix & destination,
+  const std::vector<bool> & keep )
+{
+  vector<double> row( column_count() );
+  unsigned long rows = 0;
+  unsigned long passed = 0;
+  for ( ; passed < keep.size(); ++passed )
+  {
+    if ( !keep[passed] )
+    {
+      if ( !skip_row() )
+      {
+        break;
+      }
+      continue;
+    }
+    if ( !next_row( &row[0] ) )
+    {
+      break;
+    }
+    for ( unsigned int column = 0; column < row.size(); ++column )
+    {
+      destination.at( rows, column ) = row[column];
+    }
+    ++rows;
+  }
+  return passed;
+}
+
+//------------------------------------------------------------------------------
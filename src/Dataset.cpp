@@ -1,14 +1,76 @@
 #include "Dataset.h"
 #include <stdlib.h>
+#include <algorithm>
 #include <iostream>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 using namespace std;
 
+namespace
+{
+  /**
+   * Pairs an attribute value with the binary classification of its row.
+   */
+  typedef std::pair<double, bool> AttributeClassPair;
+  typedef std::vector<AttributeClassPair> AttributeClassVector;
+
+  /**
+   * Choose the upper bin edges of a column: the values at its quantiles.
+   * Repeated values collapse into a single bin, so a column with at most
+   * bin_limit distinct values gets one bin per value.
+   * @param sorted The sorted column.
+   * @param bin_limit The maximum number of bins.
+   * @param [out] edges The edges, ascending.
+   */
+  void quantile_edges(
+    const Dataset::ThresholdVector & sorted,
+    const unsigned int bin_limit,
+    Dataset::ThresholdVector & edges )
+  {
+    unsigned int rows = sorted.size();
+    unsigned int distinct = ( rows > 0 ) ? 1 : 0;
+    for ( unsigned int row = 1; row < rows; ++row )
+    {
+      if ( sorted[row] != sorted[row - 1] )
+      {
+        ++distinct;
+      }
+    }
+    if ( distinct <= bin_limit )
+    {
+      for ( unsigned int row = 0; row < rows; ++row )
+      {
+        if ( (row + 1 == rows) || (sorted[row + 1] != sorted[row]) )
+        {
+          edges.push_back( sorted[row] );
+        }
+      }
+    }
+    else
+    {
+      for ( unsigned int bin = 1; bin <= bin_limit; ++bin )
+      {
+        double value = sorted[(static_cast<unsigned long>(rows) * bin - 1) / bin_limit];
+        if ( edges.empty() || (edges.back() != value) )
+        {
+          edges.push_back( value );
+        }
+      }
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 
-Dataset::Dataset( const unsigned int rows, const unsigned int columns ) :
+Dataset::Dataset(
+  const unsigned int rows,
+  const unsigned int columns,
+  const Layout layout ) :
   data_ref(rows),
-  data( new RealMatrix(rows, columns) ),
+  data( new RealMatrix(rows, columns, layout) ),
+  bins( null(BinnedMatrix) ),
   usingRef(false)
 {
   // Initialize dataset to point to data elements.
@@ -23,6 +85,21 @@ Dataset::Dataset( const unsigned int rows, const unsigned int columns ) :
 Dataset::Dataset( Dataset & reference, const unsigned int rows ) :
   data_ref(rows),
   data(&reference.data_matrix()),
+  bins(reference.get_bins()),
+  usingRef(true)
+{
+  //
+}
+
+//------------------------------------------------------------------------------
+
+Dataset::Dataset(
+  Dataset & reference,
+  const unsigned int begin,
+  const unsigned int end ) :
+  data_ref(&reference.data_reference()[begin], end - begin),
+  data(&reference.data_matrix()),
+  bins(reference.get_bins()),
   usingRef(true)
 {
   //
@@ -33,6 +110,7 @@ Dataset::Dataset( Dataset & reference, const unsigned int rows ) :
 Dataset::Dataset( RealMatrix & data, const unsigned int rows ) :
   data_ref(rows),
   data(&data),
+  bins( null(BinnedMatrix) ),
   usingRef(true)
 {
   //
@@ -51,36 +129,20 @@ Dataset::~Dataset( void )
 
 //------------------------------------------------------------------------------
 
-Dataset::ProbabilityMap Dataset::enumerate_threshold(
+Dataset::ThresholdHistogram Dataset::enumerate_threshold(
   const unsigned int column, const double threshold ) const
 {
-  ProbabilityMap pmap;
-  pmap["LE"]  = 0.0;
-  pmap["G"]   = 0.0;
+  ThresholdHistogram histogram;
 
+  // Iterate through elements to separate them into two categories.
   unsigned int rows = data_ref.row_count();
-  if ( rows > 0 )
+  for ( unsigned int row = 0; row < rows; ++row )
   {
-    // Iterate through elements to separate them into two categories.
-    for ( unsigned int row = 0; row < rows; ++row )
-    {
-      if ( operator[](row)[column] > threshold )
-      {
-        pmap["G"] += 1.0;
-      }
-      else
-      {
-        pmap["LE"] += 1.0;
-      }
-    }
-
-    // Normalize.
-    pmap["LE"] /= rows;
-    pmap["G"] /= rows;
+    histogram.add( ( get(row, column) > threshold ) ? Greater : LessEqual );
   }
 
   // Done.
-  return pmap;
+  return histogram;
 }
 
 //------------------------------------------------------------------------------
@@ -90,7 +152,7 @@ Dataset::ThresholdVector Dataset::get_thresholds( const unsigned int column ) co
   ThresholdVector thresholds;
   for ( unsigned int row = 0; row < row_count(); ++row )
   {
-    thresholds.push_back( operator[](row)[column] );
+    thresholds.push_back( get(row, column) );
   }
   return thresholds;
 }
@@ -109,7 +171,7 @@ DatasetSplitPair Dataset::split(
   // Partition data.
   for ( unsigned int row = 0; row < row_count(); ++row )
   {
-    if ( operator[](row)[column] > threshold )
+    if ( get(row, column) > threshold )
     {
       split.ds_g(ds_g_elements) = operator()(row);
       ++ds_g_elements;
@@ -130,46 +192,185 @@ DatasetSplitPair Dataset::split(
 
 //------------------------------------------------------------------------------
 
+unsigned int Dataset::partition(
+  const unsigned int column, const double threshold )
+{
+  // Move rows > threshold to the back, swapping them with rows <= threshold
+  // found from the back.
+  unsigned int le_end = 0;
+  unsigned int g_begin = row_count();
+  while ( true )
+  {
+    while ( (le_end < g_begin) && (get(le_end, column) <= threshold) )
+    {
+      ++le_end;
+    }
+    while ( (le_end < g_begin) && (get(g_begin - 1, column) > threshold) )
+    {
+      --g_begin;
+    }
+    if ( le_end >= g_begin )
+    {
+      break;
+    }
+    unsigned int swap = data_ref[le_end];
+    data_ref[le_end] = data_ref[g_begin - 1];
+    data_ref[g_begin - 1] = swap;
+    ++le_end;
+    --g_begin;
+  }
+  return le_end;
+}
+
+//------------------------------------------------------------------------------
+
+void Dataset::prefetch_column( const unsigned int column ) const
+{
+  if ( !data->is_mapped() )
+  {
+    return;
+  }
+  unsigned long page_rows = sysconf( _SC_PAGESIZE ) / sizeof(double);
+  unsigned long column_pages = ( data->row_count() + page_rows - 1 ) / page_rows;
+  if ( row_count() >= column_pages )
+  {
+    data->advise_column( column, PrefetchAccess );
+  }
+}
+
+//------------------------------------------------------------------------------
+
 double Dataset::information_gain(
   const unsigned int decision_column,
   const unsigned int attribute_column,
   double & threshold )
 {
+  // Gather the attribute column along with the classification of each row and
+  // sort it once by attribute value.
+  unsigned int rows = row_count();
+  AttributeClassVector column( rows );
+  ThresholdHistogram class_histogram;
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    bool classification = get(row, decision_column) > 0.0;
+    column[row] = AttributeClassPair( get(row, attribute_column), classification );
+    class_histogram.add( classification ? Greater : LessEqual );
+  }
+  sort( column.begin(), column.end() );
+
   // Calculate classification entropy.
-  ProbabilityMap enum_dc = enumerate_threshold( decision_column, 0.0 );
-  double class_entropy = enum_dc.entropy();
+  double class_entropy = class_histogram.entropy();
 
-  // Iterate over all possible thresholds.
-  ThresholdVector thresholds = get_thresholds( attribute_column );
+  // Sweep the sorted column, keeping running class counts for the LE side.
+  // Every distinct attribute value is a candidate threshold.
   double best_split_threshold = -1e199;
   double best_split_ig        = -1000.0;
-  for (
-    ThresholdVector::const_iterator iter = thresholds.begin();
-    iter != thresholds.end(); ++iter )
+  ThresholdHistogram class_histogram_le;
+  ThresholdHistogram class_histogram_g;
+  for ( unsigned int row = 0; row < rows; ++row )
   {
+    class_histogram_le.add( column[row].second ? Greater : LessEqual );
+
+    // Only evaluate once all rows with this value are on the LE side.
+    if ( (row + 1 < rows) && (column[row + 1].first == column[row].first) )
+    {
+      continue;
+    }
+
+    class_histogram_g = class_histogram;
+    class_histogram_g.subtract( class_histogram_le );
+    double split_prob_le = class_histogram_le.total() / static_cast<double>(rows);
+    double split_prob_g = class_histogram_g.total() / static_cast<double>(rows);
+
     double split_ig = class_entropy;
-    double threshold = *iter;
+    split_ig -= split_prob_le * class_histogram_le.entropy();
+    split_ig -= split_prob_g * class_histogram_g.entropy();
+
+    // Best split?
+    if ( split_ig > best_split_ig )
+    {
+      best_split_ig = split_ig;
+      best_split_threshold = column[row].first;
+    }
+  }
+
+  // Finished.
+  threshold = best_split_threshold;
+  return best_split_ig;
+}
+
+//------------------------------------------------------------------------------
+
+double Dataset::information_gain_binned(
+  const unsigned int attribute_column,
+  double & threshold ) const
+{
+  ThresholdHistogram histograms[BinnedMatrix::MaxBins];
+  bin_histograms( attribute_column, histograms );
+  return best_bin_split( *bins, attribute_column, histograms, threshold );
+}
 
-    // Enumerate at threshold.
-    DatasetSplitPair split_pair = split( attribute_column, threshold );
-    double split_prob_le = split_pair.ds_le.row_count() / static_cast<double>(row_count());
-    double split_prob_g = split_pair.ds_g.row_count() / static_cast<double>(row_count());
+//------------------------------------------------------------------------------
 
-    // For LE split, calculate new entropy.
-    ProbabilityMap enum_dc_le = split_pair.ds_le.enumerate_threshold( decision_column, 0.0 );
-    double class_entropy_le = enum_dc_le.entropy();
-    split_ig -= split_prob_le * class_entropy_le;
+void Dataset::bin_histograms(
+  const unsigned int attribute_column,
+  ThresholdHistogram * const histograms ) const
+{
+  unsigned int rows = row_count();
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    unsigned int data_index = data_ref[row];
+    histograms[bins->code( data_index, attribute_column )].add(
+      bins->classification( data_index ) ? Greater : LessEqual );
+  }
+}
+
+//------------------------------------------------------------------------------
 
-    // For G split, calculate new entropy.
-    ProbabilityMap enum_dc_g = split_pair.ds_g.enumerate_threshold( decision_column, 0.0 );
-    double class_entropy_g = enum_dc_g.entropy();
-    split_ig -= split_prob_g * class_entropy_g;
+double Dataset::best_bin_split(
+  const BinnedMatrix & bins,
+  const unsigned int attribute_column,
+  const ThresholdHistogram * const histograms,
+  double & threshold )
+{
+  ThresholdHistogram class_histogram;
+  unsigned int bin_count = bins.bin_count( attribute_column );
+  for ( unsigned int bin = 0; bin < bin_count; ++bin )
+  {
+    class_histogram.add( histograms[bin] );
+  }
+  unsigned int rows = class_histogram.total();
+
+  // Calculate classification entropy.
+  double class_entropy = class_histogram.entropy();
+
+  // Sweep the bins, evaluating the upper edge of every non-empty bin.
+  double best_split_threshold = -1e199;
+  double best_split_ig        = -1000.0;
+  ThresholdHistogram class_histogram_le;
+  ThresholdHistogram class_histogram_g;
+  for ( unsigned int bin = 0; bin < bin_count; ++bin )
+  {
+    if ( histograms[bin].total() == 0 )
+    {
+      continue;
+    }
+    class_histogram_le.add( histograms[bin] );
+
+    class_histogram_g = class_histogram;
+    class_histogram_g.subtract( class_histogram_le );
+    double split_prob_le = class_histogram_le.total() / static_cast<double>(rows);
+    double split_prob_g = class_histogram_g.total() / static_cast<double>(rows);
+
+    double split_ig = class_entropy;
+    split_ig -= split_prob_le * class_histogram_le.entropy();
+    split_ig -= split_prob_g * class_histogram_g.entropy();
 
     // Best split?
     if ( split_ig > best_split_ig )
     {
       best_split_ig = split_ig;
-      best_split_threshold = threshold;
+      best_split_threshold = bins.edge( attribute_column, bin );
     }
   }
 
@@ -180,13 +381,13 @@ double Dataset::information_gain(
 
 //------------------------------------------------------------------------------
 
-Dataset Dataset::bootstrap_sample( const unsigned int sample_size )
+Dataset Dataset::bootstrap_sample( const unsigned int sample_size, RandomStream & random )
 {
   Dataset sample( *this, sample_size );
   unsigned int rows = row_count();
   for ( unsigned int row = 0; row < sample_size; ++row )
   {
-    sample(row) = static_cast<unsigned int>(rand()) % rows;
+    sample(row) = data_ref[random.uniform( rows )];
   }
   return sample;
 }
@@ -217,6 +418,369 @@ Dataset Dataset::out_of_bag_set( void )
 
 //------------------------------------------------------------------------------
 
+Dataset::BinnedMatrix::BinnedMatrix(
+  const RealMatrix & matrix,
+  const unsigned int decision_column,
+  const unsigned int max_bins ) :
+    rows(matrix.row_count()),
+    columns(matrix.column_count()),
+    codes(new unsigned char[matrix.row_count()*matrix.column_count()]),
+    classes(new unsigned char[matrix.row_count()]),
+    edges(matrix.column_count())
+{
+  vector<unsigned int> matrix_rows;
+  classify( matrix, decision_column, matrix_rows );
+  bin( matrix, max_bins, matrix_rows );
+}
+
+//------------------------------------------------------------------------------
+
+Dataset::BinnedMatrix::BinnedMatrix(
+  const Dataset & dataset,
+  const unsigned int decision_column,
+  const unsigned int max_bins ) :
+    rows(0),
+    columns(dataset.data_matrix().column_count()),
+    codes(null(unsigned char)),
+    classes(null(unsigned char)),
+    edges(dataset.data_matrix().column_count())
+{
+  // Bin each distinct row once, in matrix order, and mark them for lookup.
+  vector<unsigned int> matrix_rows( dataset.row_count() );
+  for ( unsigned int row = 0; row < dataset.row_count(); ++row )
+  {
+    matrix_rows[row] = dataset.data_reference()[row];
+  }
+  sort( matrix_rows.begin(), matrix_rows.end() );
+  matrix_rows.erase( unique( matrix_rows.begin(), matrix_rows.end() ), matrix_rows.end() );
+  rows = matrix_rows.size();
+  unsigned int words = matrix_rows.empty() ? 1 : matrix_rows.back() / 64 + 1;
+  row_bits.assign( words, 0 );
+  row_ranks.assign( words, 0 );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    row_bits[matrix_rows[row] / 64] |= static_cast<uint64_t>(1) << (matrix_rows[row] % 64);
+  }
+  for ( unsigned int word = 1; word < words; ++word )
+  {
+    row_ranks[word] = row_ranks[word - 1] + __builtin_popcountll( row_bits[word - 1] );
+  }
+
+  const RealMatrix & matrix = dataset.data_matrix();
+  codes = new unsigned char[static_cast<size_t>(rows)*columns];
+  classes = new unsigned char[rows];
+  classify( matrix, decision_column, matrix_rows );
+  bin( matrix, max_bins, matrix_rows );
+}
+
+//------------------------------------------------------------------------------
+
+Dataset::BinnedMatrix::BinnedMatrix(
+  const RealMatrix & matrix,
+  const unsigned int decision_column,
+  const std::vector<ThresholdVector> & column_edges ) :
+    rows(matrix.row_count()),
+    columns(matrix.column_count()),
+    codes(new unsigned char[matrix.row_count()*matrix.column_count()]),
+    classes(new unsigned char[matrix.row_count()]),
+    edges(column_edges)
+{
+  vector<unsigned int> matrix_rows;
+  classify( matrix, decision_column, matrix_rows );
+  for ( unsigned int column = 0; column < columns; ++column )
+  {
+    matrix.advise_column( column, SequentialAccess );
+    encode( matrix, column, matrix_rows );
+    matrix.advise_column( column, NormalAccess );
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Dataset::BinnedMatrix::bin(
+  const RealMatrix & matrix,
+  const unsigned int max_bins,
+  const std::vector<unsigned int> & matrix_rows )
+{
+  unsigned int bin_limit = ( max_bins > MaxBins ) ? MaxBins : max_bins;
+  if ( bin_limit == 0 )
+  {
+    bin_limit = 1;
+  }
+
+  ThresholdVector sorted( rows );
+  for ( unsigned int column = 0; column < columns; ++column )
+  {
+    // Sort the column to find its quantiles.
+    matrix.advise_column( column, SequentialAccess );
+    for ( unsigned int row = 0; row < rows; ++row )
+    {
+      sorted[row] = matrix.get( matrix_rows.empty() ? row : matrix_rows[row], column );
+    }
+    sort( sorted.begin(), sorted.end() );
+
+    // Bin edges are the values at each quantile. Repeated values collapse
+    // into a single bin, so columns with few distinct values are exact.
+    quantile_edges( sorted, bin_limit, edges[column] );
+
+    // Encode the column while it's still paged in.
+    encode( matrix, column, matrix_rows );
+    matrix.advise_column( column, NormalAccess );
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Dataset::BinnedMatrix::merge_edges(
+  const ThresholdVector & candidates,
+  const std::vector<double> & weights,
+  const unsigned int max_bins,
+  ThresholdVector & edges )
+{
+  unsigned int bin_limit = ( max_bins > MaxBins ) ? MaxBins : max_bins;
+  if ( bin_limit == 0 )
+  {
+    bin_limit = 1;
+  }
+
+  // Sort the candidates, adding up the weights of repeated ones.
+  vector< pair<double, double> > sorted;
+  for ( unsigned int candidate = 0; candidate < candidates.size(); ++candidate )
+  {
+    sorted.push_back( make_pair( candidates[candidate], weights[candidate] ) );
+  }
+  sort( sorted.begin(), sorted.end() );
+  vector< pair<double, double> > merged;
+  double total = 0.0;
+  for ( unsigned int candidate = 0; candidate < sorted.size(); ++candidate )
+  {
+    if ( !merged.empty() && (merged.back().first == sorted[candidate].first) )
+    {
+      merged.back().second += sorted[candidate].second;
+    }
+    else
+    {
+      merged.push_back( sorted[candidate] );
+    }
+    total += sorted[candidate].second;
+  }
+
+  // Few enough candidates are all edges. Otherwise an edge is the candidate
+  // where the running weight reaches each quantile, plus the largest one.
+  edges.clear();
+  unsigned int bin = 1;
+  double running = 0.0;
+  for ( unsigned int candidate = 0; candidate < merged.size(); ++candidate )
+  {
+    running += merged[candidate].second;
+    bool crossed = ( bin < bin_limit ) && ( running >= total * bin / bin_limit );
+    if ( (merged.size() <= bin_limit) || crossed || (candidate + 1 == merged.size()) )
+    {
+      edges.push_back( merged[candidate].first );
+    }
+    while ( (bin < bin_limit) && (running >= total * bin / bin_limit) )
+    {
+      ++bin;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Dataset::BinnedMatrix::classify(
+  const RealMatrix & matrix,
+  const unsigned int decision_column,
+  const std::vector<unsigned int> & matrix_rows )
+{
+  matrix.advise_column( decision_column, SequentialAccess );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    unsigned int matrix_row = matrix_rows.empty() ? row : matrix_rows[row];
+    classes[row] = ( matrix.get(matrix_row, decision_column) > 0.0 ) ? 1 : 0;
+  }
+  matrix.advise_column( decision_column, NormalAccess );
+}
+
+//------------------------------------------------------------------------------
+
+void Dataset::BinnedMatrix::encode(
+  const RealMatrix & matrix,
+  const unsigned int column,
+  const std::vector<unsigned int> & matrix_rows )
+{
+  // Values above the last edge (only possible with given edges) go into the
+  // last bin.
+  const ThresholdVector & column_edges = edges[column];
+  unsigned int last_bin = column_edges.empty() ? 0 : column_edges.size() - 1;
+  unsigned char * column_codes = &codes[column*rows];
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    unsigned int matrix_row = matrix_rows.empty() ? row : matrix_rows[row];
+    unsigned int bin =
+      lower_bound( column_edges.begin(), column_edges.end(), matrix.get(matrix_row, column) )
+      - column_edges.begin();
+    column_codes[row] = static_cast<unsigned char>( (bin > last_bin) ? last_bin : bin );
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Dataset::RealMatrix::RealMatrix(
+  const Dataset & source,
+  const Storage storage,
+  const unsigned int max_codes ) :
+    owned(true), mapped(false), storage(storage),
+    rows(source.row_count()), columns(source.data_matrix().column_count()),
+    layout(ColumnMajor), data(null(double)), floats(null(float))
+{
+  set_strides();
+  if ( storage == DoubleStorage )
+  {
+    data = new double[rows*columns];
+  }
+  else if ( storage == FloatStorage )
+  {
+    floats = new float[rows*columns];
+  }
+  else
+  {
+    code_columns.resize( columns );
+  }
+
+  // Copy a column at a time, reading a mapped source front to back.
+  const RealMatrix & matrix = source.data_matrix();
+  for ( unsigned int column = 0; column < columns; ++column )
+  {
+    matrix.advise_column( column, SequentialAccess );
+    if ( storage == DoubleStorage )
+    {
+      for ( unsigned int row = 0; row < rows; ++row )
+      {
+        data[column*rows + row] = source.get( row, column );
+      }
+    }
+    else if ( storage == FloatStorage )
+    {
+      for ( unsigned int row = 0; row < rows; ++row )
+      {
+        floats[column*rows + row] = static_cast<float>( source.get( row, column ) );
+      }
+    }
+    else
+    {
+      encode( source, column, max_codes );
+    }
+    matrix.advise_column( column, NormalAccess );
+  }
+}
+
+//------------------------------------------------------------------------------
+
+unsigned long Dataset::RealMatrix::byte_size( void ) const
+{
+  unsigned long elements = static_cast<unsigned long>(rows) * columns;
+  if ( storage == DoubleStorage )
+  {
+    return elements * sizeof(double);
+  }
+  if ( storage == FloatStorage )
+  {
+    return elements * sizeof(float);
+  }
+  unsigned long size = 0;
+  for ( unsigned int column = 0; column < columns; ++column )
+  {
+    const CodeColumn & code_column = code_columns[column];
+    size += code_column.narrow.size() * sizeof(unsigned char);
+    size += code_column.wide.size() * sizeof(unsigned short);
+    size += code_column.values.size() * sizeof(double);
+  }
+  return size;
+}
+
+//------------------------------------------------------------------------------
+
+void Dataset::RealMatrix::encode(
+  const Dataset & source,
+  const unsigned int column,
+  const unsigned int max_codes )
+{
+  unsigned int code_limit = ( max_codes > MaxCodes ) ? MaxCodes : max_codes;
+  if ( code_limit == 0 )
+  {
+    code_limit = 1;
+  }
+
+  // The values are the column's distinct values if there are few enough, and
+  // otherwise the upper edges of its quantile bins.
+  ThresholdVector column_values( rows );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    column_values[row] = source.get( row, column );
+  }
+  ThresholdVector sorted( column_values );
+  sort( sorted.begin(), sorted.end() );
+  CodeColumn & code_column = code_columns[column];
+  quantile_edges( sorted, code_limit, code_column.values );
+
+  // Every element becomes the first value >= it. The last value is the
+  // column's largest, so there always is one.
+  const ThresholdVector & values = code_column.values;
+  if ( values.size() <= 256 )
+  {
+    code_column.narrow.resize( rows );
+  }
+  else
+  {
+    code_column.wide.resize( rows );
+  }
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    unsigned int code =
+      lower_bound( values.begin(), values.end(), column_values[row] ) - values.begin();
+    if ( code_column.wide.empty() )
+    {
+      code_column.narrow[row] = static_cast<unsigned char>( code );
+    }
+    else
+    {
+      code_column.wide[row] = static_cast<unsigned short>( code );
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Dataset::RealMatrix::advise_column(
+  const unsigned int column,
+  const ColumnAccess access ) const
+{
+  if ( !mapped || (layout != ColumnMajor) || (rows == 0) )
+  {
+    return;
+  }
+
+  // Hints apply to whole pages: round the column out to page boundaries.
+  uintptr_t page_size = sysconf( _SC_PAGESIZE );
+  uintptr_t begin = reinterpret_cast<uintptr_t>( column_data(column) );
+  uintptr_t end = begin + static_cast<uintptr_t>(rows) * sizeof(double);
+  begin -= begin % page_size;
+  end += ( page_size - end % page_size ) % page_size;
+
+  int advice = MADV_NORMAL;
+  if ( access == SequentialAccess )
+  {
+    advice = MADV_SEQUENTIAL;
+  }
+  else if ( access == PrefetchAccess )
+  {
+    advice = MADV_WILLNEED;
+  }
+  madvise( reinterpret_cast<void*>(begin), end - begin, advice );
+}
+
+//------------------------------------------------------------------------------
+
 std::ostream & operator<<( std::ostream & stream, const Dataset::IntegerColumn & column )
 {
   stream << "Row count: " << column.row_count() << "; Rows:";
@@ -240,7 +804,7 @@ std::ostream & operator<<( std::ostream & stream, const Dataset::RealMatrix & ma
         << std::setiosflags(std::ios::fixed)
         << std::setprecision(2)
         << std::setw(8)
-        << matrix[row][column];
+        << matrix.get(row, column);
     }
     stream << endl;
   }
@@ -7,7 +7,14 @@
 
 #include "RandomForest.h"
 
+#include <algorithm>
 #include <iostream>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -19,49 +26,156 @@ void RandomForest::grow_forest(
   const unsigned int bootstrap_size,
   const Dataset::KeyList & split_keys,
   const unsigned int keys_per_node,
-  const unsigned int tree_count )
+  const unsigned int tree_count,
+  const unsigned int first_tree )
 {
   // If a forest exits, destroy it.
   burn();
 
+  // Bin the dataset's rows for histogram split finding, unless the caller
+  // already has.
+  Dataset::BinnedMatrix * bins = null(Dataset::BinnedMatrix);
+  if ( (histogram_bins > 0) && (dataset.get_bins() == null(Dataset::BinnedMatrix)) )
+  {
+    bins = new Dataset::BinnedMatrix( dataset, decision_column, histogram_bins );
+    dataset.set_bins( bins );
+  }
+
   // Initialize result queue.
   ResultQueue results;
 
-  // Initialize tasks.
-  unsigned int task_count = 1;
-  unsigned int trees_per_task = tree_count / task_count;
-  unsigned int total_trees = trees_per_task * task_count;
-  vector<ForestGrowingTask*> task_list;
-  for ( unsigned int task_id = 0; task_id < task_count; ++task_id )
-  {
-    ForestGrowingTask *task = new ForestGrowingTask(
-      dataset, decision_column, bootstrap_size, split_keys, keys_per_node,
-      trees_per_task, &results );
-    task->spawn();
-  }
+  // Grow the trees on a thread pool, one task per tree.
+  ThreadPool pool( thread_count );
+  ForestGrowingTask task(
+    dataset, decision_column, bootstrap_size, split_keys, keys_per_node,
+    seed, stream, first_tree, &results );
+  pool.start( task, tree_count );
 
-  // Fetch results.
+  // Fetch results. Trees are stored by index, whichever thread grew them.
+  forest.resize( tree_count, null(RandomTree) );
   unsigned int on_tree = 0;
-  while ( forest.size() < total_trees )
+  while ( on_tree < tree_count )
   {
-    RandomTree * result = results.pop();
-    forest.push_back( result );
+    Result result = results.pop();
+    forest[result.index] = result.tree;
 
     ++on_tree;
+    if ( progress == null(ostream) )
+    {
+      continue;
+    }
     if ((on_tree % 50) == 0)
     {
-      cout << " ; " << on_tree << " of " << total_trees << " (" << on_tree*100.0/total_trees << "%)" << endl;
+      *progress << " ; " << on_tree << " of " << tree_count << " (" << on_tree*100.0/tree_count << "%)" << endl;
     }
     else if ((on_tree % 10) == 0)
     {
-      cout << "|" << flush;
+      *progress << "|" << flush;
     }
     else
     {
-      cout << "." << flush;
+      *progress << "." << flush;
+    }
+  }
+  if ( progress != null(ostream) )
+  {
+    *progress << endl;
+  }
+  pool.join();
+
+  // Release the bins.
+  if ( bins != null(Dataset::BinnedMatrix) )
+  {
+    dataset.set_bins( null(Dataset::BinnedMatrix) );
+    delete bins;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void RandomForest::grow_forest_distributed(
+  Dataset & dataset,
+  const unsigned int decision_column,
+  const unsigned int bootstrap_size,
+  const Dataset::KeyList & split_keys,
+  const unsigned int keys_per_node,
+  const unsigned int tree_count,
+  HistogramReducer & reducer )
+{
+  // If a forest exits, destroy it.
+  burn();
+
+  // Agree on the bin edges. Every process bins its own shard and sends the
+  // upper edge and row count of each bin, flattened per column as the bin
+  // count followed by edge, rows pairs. All of them merge the same bins into
+  // the same edges.
+  const Dataset::RealMatrix & matrix = dataset.data_matrix();
+  unsigned int column_count = matrix.column_count();
+  unsigned int bin_limit =
+    ( histogram_bins > 0 ) ? histogram_bins : Dataset::BinnedMatrix::MaxBins;
+  vector<double> flat;
+  {
+    Dataset::BinnedMatrix local_bins( matrix, decision_column, bin_limit );
+    vector<double> bin_rows;
+    for ( unsigned int column = 0; column < column_count; ++column )
+    {
+      bin_rows.assign( local_bins.bin_count( column ), 0.0 );
+      for ( unsigned int row = 0; row < matrix.row_count(); ++row )
+      {
+        bin_rows[local_bins.code( row, column )] += 1.0;
+      }
+      flat.push_back( local_bins.bin_count( column ) );
+      for ( unsigned int bin = 0; bin < local_bins.bin_count( column ); ++bin )
+      {
+        flat.push_back( local_bins.edge( column, bin ) );
+        flat.push_back( bin_rows[bin] );
+      }
     }
   }
-  cout << endl;
+  reducer.gather( flat );
+
+  vector<Dataset::ThresholdVector> candidates( column_count );
+  vector< vector<double> > weights( column_count );
+  unsigned int position = 0;
+  bool valid = true;
+  while ( valid && (position < flat.size()) )
+  {
+    for ( unsigned int column = 0; valid && (column < column_count); ++column )
+    {
+      unsigned int count = static_cast<unsigned int>( flat[position++] );
+      valid =
+        ( count <= Dataset::BinnedMatrix::MaxBins ) &&
+        ( position + 2 * count <= flat.size() );
+      for ( unsigned int bin = 0; valid && (bin < count); ++bin )
+      {
+        candidates[column].push_back( flat[position++] );
+        weights[column].push_back( flat[position++] );
+      }
+    }
+  }
+  vector<Dataset::ThresholdVector> edges( column_count );
+  for ( unsigned int column = 0; column < column_count; ++column )
+  {
+    Dataset::BinnedMatrix::merge_edges(
+      candidates[column], weights[column], bin_limit, edges[column] );
+  }
+  Dataset::BinnedMatrix bins( matrix, decision_column, edges );
+  dataset.set_bins( &bins );
+
+  // Grow the trees in step with the other processes.
+  forest.resize( tree_count, null(RandomTree) );
+  for ( unsigned int t = 0; t < tree_count; ++t )
+  {
+    RandomStream sample_random( seed, stream, t );
+    RandomStream key_random( seed, SharedStream, t );
+    Dataset bootstrap = dataset.bootstrap_sample( bootstrap_size, sample_random );
+
+    forest[t] = new RandomTree;
+    forest[t]->grow_decision_tree_distributed(
+      bootstrap, split_keys, keys_per_node, decision_column, key_random, reducer );
+  }
+
+  dataset.set_bins( null(Dataset::BinnedMatrix) );
 }
 
 //------------------------------------------------------------------------------
@@ -95,6 +209,332 @@ bool RandomForest::classify( const double * const & row )
 
 //------------------------------------------------------------------------------
 
+void RandomForest::classify_batch(
+  const Dataset & dataset, bool * const classifications ) const
+{
+  unsigned int rows = dataset.row_count();
+  unsigned int tree_count = forest.size();
+  unsigned int block_count = (rows + BatchBlockRows - 1) / BatchBlockRows;
+  unsigned int threads = ( thread_count > 0 ) ?
+    thread_count : ThreadPool::hardware_concurrency();
+
+  // Small batches aren't worth the threads.
+  if ( (threads <= 1) || (static_cast<double>(rows) * tree_count < ParallelBatchVotes) )
+  {
+    vector<unsigned int> votes( BatchBlockRows );
+    for ( unsigned int begin = 0; begin < rows; begin += BatchBlockRows )
+    {
+      unsigned int end = ( rows - begin > BatchBlockRows ) ? begin + BatchBlockRows : rows;
+      classify_block( dataset, begin, end, &votes[0], classifications );
+    }
+    return;
+  }
+
+  // Enough blocks to go around: one task per block.
+  if ( block_count >= threads )
+  {
+    ThreadPool pool( threads );
+    BlockClassifyTask task( *this, dataset, classifications );
+    pool.run( task, block_count );
+    return;
+  }
+
+  // Otherwise share out the trees and merge the votes.
+  unsigned int share_count = min( threads, tree_count );
+  vector< vector<unsigned int> > votes( share_count, vector<unsigned int>(rows, 0u) );
+  ThreadPool pool( share_count );
+  TreeVoteTask task( *this, dataset, votes );
+  pool.run( task, share_count );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    unsigned int row_votes = 0;
+    for ( unsigned int share = 0; share < share_count; ++share )
+    {
+      row_votes += votes[share][row];
+    }
+    classifications[row] = 2 * row_votes > tree_count;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void RandomForest::classify_block(
+  const Dataset & dataset,
+  const unsigned int begin,
+  const unsigned int end,
+  unsigned int * const votes,
+  bool * const classifications ) const
+{
+  unsigned int tree_count = forest.size();
+
+  // Stream the block through one tree at a time.
+  fill( votes, votes + (end - begin), 0u );
+  for ( unsigned int tree_index = 0; tree_index < tree_count; ++tree_index )
+  {
+    forest[tree_index]->vote_batch( dataset, begin, end, votes );
+  }
+
+  // Majority vote.
+  for ( unsigned int row = begin; row < end; ++row )
+  {
+    classifications[row] = 2 * votes[row - begin] > tree_count;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+ostream & RandomForest::write_model(
+  ostream & stream, const Dataset::KeyList * const keys ) const
+{
+  // Tree table: the first node of each tree, then the total. Rows must have
+  // every column the splits read.
+  unsigned int tree_count = forest.size();
+  unsigned int column_count = 0;
+  vector<uint64_t> tree_table( tree_count + 1, 0 );
+  for ( unsigned int tree_index = 0; tree_index < tree_count; ++tree_index )
+  {
+    const RandomTree & tree = *forest[tree_index];
+    tree_table[tree_index + 1] = tree_table[tree_index] + tree.get_compiled_node_count();
+    for ( unsigned int index = 0; index < tree.get_compiled_node_count(); ++index )
+    {
+      const RandomTree::CompiledNode & node = tree.get_compiled_nodes()[index];
+      if ( (node.column != RandomTree::LeafColumn) && (node.column >= column_count) )
+      {
+        column_count = node.column + 1;
+      }
+    }
+  }
+
+  // String table.
+  string strings;
+  if ( keys != null(const Dataset::KeyList) )
+  {
+    for (
+      Dataset::KeyList::const_iterator iter = keys->begin();
+      iter != keys->end(); ++iter )
+    {
+      uint32_t column = iter->second;
+      uint32_t length = iter->first.size();
+      strings.append( reinterpret_cast<const char*>(&column), sizeof(column) );
+      strings.append( reinterpret_cast<const char*>(&length), sizeof(length) );
+      strings.append( iter->first );
+    }
+  }
+
+  // Header. The header and tree table are multiples of 8 bytes, so the node
+  // array is aligned.
+  ModelFile::Header header;
+  memset( &header, 0, sizeof(header) );
+  memcpy( header.magic, ModelFile::Magic, sizeof(header.magic) );
+  header.byte_order = ModelFile::ByteOrderMark;
+  header.version = ModelFile::Version;
+  header.tree_count = tree_count;
+  header.node_size = sizeof(RandomTree::CompiledNode);
+  header.node_count = tree_table[tree_count];
+  header.column_count = column_count;
+  header.tree_table_offset = sizeof(header);
+  header.node_offset = header.tree_table_offset + tree_table.size() * sizeof(uint64_t);
+  if ( keys != null(const Dataset::KeyList) )
+  {
+    header.string_table_offset =
+      header.node_offset + header.node_count * sizeof(RandomTree::CompiledNode);
+    header.string_table_size = strings.size();
+  }
+
+  // Write.
+  stream.write( reinterpret_cast<const char*>(&header), sizeof(header) );
+  stream.write(
+    reinterpret_cast<const char*>(&tree_table[0]),
+    tree_table.size() * sizeof(uint64_t) );
+  for ( unsigned int tree_index = 0; tree_index < tree_count; ++tree_index )
+  {
+    stream.write(
+      reinterpret_cast<const char*>(forest[tree_index]->get_compiled_nodes()),
+      forest[tree_index]->get_compiled_node_count() * sizeof(RandomTree::CompiledNode) );
+  }
+  stream.write( strings.data(), strings.size() );
+  return stream;
+}
+
+//------------------------------------------------------------------------------
+
+bool RandomForest::load_model( const void * const data, const size_t size )
+{
+  burn();
+
+  // Check the header.
+  const char * bytes = reinterpret_cast<const char*>(data);
+  ModelFile::Header header;
+  if ( (size < sizeof(header)) || ((reinterpret_cast<size_t>(bytes) % 8) != 0) )
+  {
+    return false;
+  }
+  memcpy( &header, bytes, sizeof(header) );
+  if ( (memcmp(header.magic, ModelFile::Magic, sizeof(header.magic)) != 0) ||
+       (header.byte_order != ModelFile::ByteOrderMark) ||
+       (header.version != ModelFile::Version) ||
+       (header.node_size != sizeof(RandomTree::CompiledNode)) )
+  {
+    return false;
+  }
+
+  // Check the sections lie inside the model.
+  uint64_t table_size = (static_cast<uint64_t>(header.tree_count) + 1) * sizeof(uint64_t);
+  if ( (header.tree_table_offset % 8 != 0) ||
+       (header.tree_table_offset > size) ||
+       (table_size > size - header.tree_table_offset) ||
+       (header.node_offset % 8 != 0) ||
+       (header.node_offset > size) ||
+       (header.node_count > (size - header.node_offset) / sizeof(RandomTree::CompiledNode)) ||
+       (header.string_table_offset > size) ||
+       (header.string_table_size > size - header.string_table_offset) )
+  {
+    return false;
+  }
+  const uint64_t * tree_table =
+    reinterpret_cast<const uint64_t*>(bytes + header.tree_table_offset);
+  const RandomTree::CompiledNode * nodes =
+    reinterpret_cast<const RandomTree::CompiledNode*>(bytes + header.node_offset);
+
+  // Check every split reads a column rows are known to have and points
+  // forward to two children inside its own tree, so classification can't
+  // leave the row or the tree, or loop.
+  for ( unsigned int tree_index = 0; tree_index < header.tree_count; ++tree_index )
+  {
+    uint64_t first = tree_table[tree_index];
+    uint64_t last = tree_table[tree_index + 1];
+    if ( (first > last) || (last > header.node_count) || (last - first > 0xFFFFFFFFu) )
+    {
+      return false;
+    }
+    uint64_t count = last - first;
+    for ( uint64_t index = 0; index < count; ++index )
+    {
+      const RandomTree::CompiledNode & node = nodes[first + index];
+      if ( (node.column != RandomTree::LeafColumn) &&
+           ((node.column >= header.column_count) ||
+            (node.child <= index) ||
+            (static_cast<uint64_t>(node.child) + 1 >= count)) )
+      {
+        return false;
+      }
+    }
+  }
+
+  // Attach the trees.
+  forest.reserve( header.tree_count );
+  for ( unsigned int tree_index = 0; tree_index < header.tree_count; ++tree_index )
+  {
+    RandomTree * tree = new RandomTree;
+    tree->attach(
+      nodes + tree_table[tree_index],
+      tree_table[tree_index + 1] - tree_table[tree_index] );
+    forest.push_back( tree );
+  }
+  model_data = bytes;
+  model_size = size;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool RandomForest::map_model( const string & filename )
+{
+  burn();
+
+  // Map the file.
+  int file = open( filename.c_str(), O_RDONLY );
+  if ( file < 0 )
+  {
+    return false;
+  }
+  struct stat status;
+  if ( (fstat(file, &status) != 0) || (status.st_size <= 0) )
+  {
+    close( file );
+    return false;
+  }
+  size_t size = status.st_size;
+  void * map = mmap( NULL, size, PROT_READ, MAP_PRIVATE, file, 0 );
+  close( file );
+  if ( map == MAP_FAILED )
+  {
+    return false;
+  }
+
+  // Attach the trees.
+  if ( !load_model(map, size) )
+  {
+    munmap( map, size );
+    return false;
+  }
+  model_map = map;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool RandomForest::read_model_keys( Dataset::KeyList & keys ) const
+{
+  if ( model_data == null(const char) )
+  {
+    return false;
+  }
+  ModelFile::Header header;
+  memcpy( &header, model_data, sizeof(header) );
+  if ( header.string_table_offset == 0 )
+  {
+    return false;
+  }
+
+  // Read records until the table runs out.
+  const char * record = model_data + header.string_table_offset;
+  const char * end = record + header.string_table_size;
+  while ( end - record >= 2 * static_cast<ptrdiff_t>(sizeof(uint32_t)) )
+  {
+    uint32_t column = 0;
+    uint32_t length = 0;
+    memcpy( &column, record, sizeof(column) );
+    memcpy( &length, record + sizeof(column), sizeof(length) );
+    record += sizeof(column) + sizeof(length);
+    if ( length > static_cast<size_t>(end - record) )
+    {
+      break;
+    }
+    keys[string(record, length)] = column;
+    record += length;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int RandomForest::get_model_column_count( void ) const
+{
+  if ( model_data == null(const char) )
+  {
+    return 0;
+  }
+  ModelFile::Header header;
+  memcpy( &header, model_data, sizeof(header) );
+  return header.column_count;
+}
+
+//------------------------------------------------------------------------------
+
+void RandomForest::release_model( void )
+{
+  if ( model_map != null(void) )
+  {
+    munmap( model_map, model_size );
+    model_map = null(void);
+  }
+  model_data = null(const char);
+  model_size = 0;
+}
+
+//------------------------------------------------------------------------------
+
 void RandomForest::classify_oob( const Dataset::KeyList & keys_to_permute )
 {
   //
@@ -64,7 +64,8 @@ void RandomTree::grow_decision_tree(
   Dataset & data,
   const Dataset::KeyList & split_keys,
   const unsigned int keys_per_node,
-  const unsigned int decision_column)
+  const unsigned int decision_column,
+  RandomStream & random )
 {
   // If tree exists, DESTROY IT.
   burn();
@@ -75,10 +76,19 @@ void RandomTree::grow_decision_tree(
     return;
   }
 
+  // Copy the row indices into a single buffer for the whole tree. Every node
+  // is a range of it, which is partitioned in place when the node splits.
+  Dataset tree_data( data, data.row_count() );
+  for ( unsigned int row = 0; row < data.row_count(); ++row )
+  {
+    tree_data(row) = data(row);
+  }
+
   // Build the decision tree.
   _grow_decision_tree(
-    data, split_keys, keys_per_node,
-    decision_column, root, "<root>" );
+    tree_data, split_keys, keys_per_node,
+    decision_column, random, root, "<root>" );
+  compile();
 }
 
 //---------
@@ -88,6 +98,7 @@ void RandomTree::_grow_decision_tree(
   const Dataset::KeyList & split_keys,
   const unsigned int keys_per_node,
   const unsigned int decision_column,
+  RandomStream & random,
   Node * const parent,
   const std::string action )
 {
@@ -102,24 +113,21 @@ Split stats:
   - Highest IG Thr:  6.0
   - Highest IG Col:  recency  /  1
  */
-  Dataset::ProbabilityMap pm_class =
+  Dataset::ThresholdHistogram class_histogram =
     data.enumerate_threshold( decision_column, 0 );
-  //double entropy = pm_class.entropy();
 
   // Choose a random subset of keys.
-  Dataset::KeyList sample_keys;
-  while ( sample_keys.size() < keys_per_node )
+  Dataset::KeyList sample_keys = choose_keys( split_keys, keys_per_node, random );
+
+  // Page in the columns to be scanned together, when the data is mapped.
+  if ( data.get_bins() == null(Dataset::BinnedMatrix) )
   {
-    unsigned int index = rand() % split_keys.size();
-    Dataset::KeyList::const_iterator iter = split_keys.begin();
-    unsigned int index_dec = index;
-    while ( index_dec-- )
-    {
-      ++iter;
-    }
-    if ( sample_keys.find(iter->first) == sample_keys.end() )
+    data.prefetch_column( decision_column );
+    for (
+      Dataset::KeyList::const_iterator key = sample_keys.begin();
+      key != sample_keys.end(); ++key )
     {
-      sample_keys[iter->first] = iter->second;
+      data.prefetch_column( key->second );
     }
   }
 
@@ -134,11 +142,23 @@ Split stats:
     key != sample_keys.end(); ++key )
   {
     double threshold = 0.0;
-    double ig = data.information_gain(
-      // INPUT
-      decision_column, key->second,
-      // OUTPUT
-      threshold );
+    double ig = 0.0;
+    if ( data.get_bins() != null(Dataset::BinnedMatrix) )
+    {
+      ig = data.information_gain_binned(
+        // INPUT
+        key->second,
+        // OUTPUT
+        threshold );
+    }
+    else
+    {
+      ig = data.information_gain(
+        // INPUT
+        decision_column, key->second,
+        // OUTPUT
+        threshold );
+    }
     if ( ig > highest_ig )
     {
       finished_splitting = false;
@@ -153,18 +173,10 @@ Split stats:
   if ( finished_splitting )
   {
     // Determine best classification.
-    bool best_class = (pm_class["LE"] < pm_class["G"]);
+    bool best_class = ( class_histogram.majority() == Dataset::Greater );
 
     // Add leaf node.
-    Node * leaf = new LeafNode( action, best_class );
-    if ( parent == null(Node) )
-    {
-      root = leaf;
-    }
-    else
-    {
-      parent->add_child(leaf);
-    }
+    attach_node( parent, new LeafNode( action, best_class ) );
   }
 
   // Not finished splitting.
@@ -173,77 +185,325 @@ Split stats:
     // Add split node.
     Node * split = new SplitNode( action, highest_ig_column, highest_ig_threshold );
 
-    // Split data.
-    DatasetSplitPair split_pair = data.split( highest_ig_column, highest_ig_threshold );
+    // Split data in place.
+    unsigned int split_row = data.partition( highest_ig_column, highest_ig_threshold );
+    Dataset data_le( data, 0, split_row );
+    Dataset data_g( data, split_row, data.row_count() );
 
     // Build <= node.
     stringstream action_le;
     action_le << highest_ig_column_str << " <= " << highest_ig_threshold;
     _grow_decision_tree(
-      split_pair.ds_le, split_keys, keys_per_node,
-      decision_column, split, action_le.str() );
+      data_le, split_keys, keys_per_node,
+      decision_column, random, split, action_le.str() );
 
     // Build > node.
     stringstream action_g;
     action_g << highest_ig_column_str << " > " << highest_ig_threshold;
     _grow_decision_tree(
-      split_pair.ds_g, split_keys, keys_per_node,
-      decision_column, split, action_g.str() );
+      data_g, split_keys, keys_per_node,
+      decision_column, random, split, action_g.str() );
 
     // Add node to tree.
-    if ( parent == null(Node) )
+    attach_node( parent, split );
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void RandomTree::grow_decision_tree_distributed(
+  Dataset & data,
+  const Dataset::KeyList & split_keys,
+  const unsigned int keys_per_node,
+  const unsigned int decision_column,
+  RandomStream & random,
+  HistogramReducer & reducer )
+{
+  // If tree exists, DESTROY IT.
+  burn();
+
+  // There should be enough keys to split on.
+  if ( split_keys.size() < keys_per_node )
+  {
+    return;
+  }
+
+  // Partition a copy of the row indices, as in grow_decision_tree().
+  Dataset tree_data( data, data.row_count() );
+  for ( unsigned int row = 0; row < data.row_count(); ++row )
+  {
+    tree_data(row) = data(row);
+  }
+
+  // Build the decision tree.
+  _grow_decision_tree_distributed(
+    tree_data, split_keys, keys_per_node,
+    decision_column, random, reducer, root, "<root>" );
+  compile();
+}
+
+//---------
+
+void RandomTree::_grow_decision_tree_distributed(
+  Dataset & data,
+  const Dataset::KeyList & split_keys,
+  const unsigned int keys_per_node,
+  const unsigned int decision_column,
+  RandomStream & random,
+  HistogramReducer & reducer,
+  Node * const parent,
+  const std::string action )
+{
+  const Dataset::BinnedMatrix & bins = *data.get_bins();
+
+  // Every process draws the same keys.
+  Dataset::KeyList sample_keys = choose_keys( split_keys, keys_per_node, random );
+
+  // Count the local class histogram and the per-bin histograms of every key
+  // into one buffer, so each node costs a single reduction.
+  Dataset::ThresholdHistogram class_histogram =
+    data.enumerate_threshold( decision_column, 0 );
+  vector<Dataset::ThresholdHistogram> histograms;
+  vector<unsigned int> offsets;
+  for (
+    Dataset::KeyList::const_iterator key = sample_keys.begin();
+    key != sample_keys.end(); ++key )
+  {
+    offsets.push_back( histograms.size() );
+    if ( bins.bin_count( key->second ) > 0 )
     {
-      root = split;
+      histograms.resize( histograms.size() + bins.bin_count( key->second ) );
+      data.bin_histograms( key->second, &histograms[offsets.back()] );
     }
-    else
+  }
+
+  vector<unsigned int> counts( 2 * (histograms.size() + 1) );
+  counts[0] = class_histogram[Dataset::LessEqual];
+  counts[1] = class_histogram[Dataset::Greater];
+  for ( unsigned int bin = 0; bin < histograms.size(); ++bin )
+  {
+    counts[2 * bin + 2] = histograms[bin][Dataset::LessEqual];
+    counts[2 * bin + 3] = histograms[bin][Dataset::Greater];
+  }
+  reducer.sum( counts );
+  class_histogram[Dataset::LessEqual] = counts[0];
+  class_histogram[Dataset::Greater] = counts[1];
+  for ( unsigned int bin = 0; bin < histograms.size(); ++bin )
+  {
+    histograms[bin][Dataset::LessEqual] = counts[2 * bin + 2];
+    histograms[bin][Dataset::Greater] = counts[2 * bin + 3];
+  }
+
+  // Determine highest information gain over the global histograms.
+  bool          finished_splitting    = true;
+  double        highest_ig            =  0.0;
+  unsigned int  highest_ig_column     =  0;
+  std::string   highest_ig_column_str = "";
+  double        highest_ig_threshold  = -1.0;
+  unsigned int  key_index             =  0;
+  for (
+    Dataset::KeyList::const_iterator key = sample_keys.begin();
+    key != sample_keys.end(); ++key, ++key_index )
+  {
+    if ( bins.bin_count( key->second ) == 0 )
     {
-      parent->add_child(split);
+      continue;
     }
+    double threshold = 0.0;
+    double ig = Dataset::best_bin_split(
+      bins, key->second, &histograms[offsets[key_index]], threshold );
+    if ( ig > highest_ig )
+    {
+      finished_splitting = false;
+      highest_ig = ig;
+      highest_ig_threshold = threshold;
+      highest_ig_column = key->second;
+      highest_ig_column_str = key->first;
+    }
+  }
+
+  // Finished splitting?
+  if ( finished_splitting )
+  {
+    bool best_class = ( class_histogram.majority() == Dataset::Greater );
+    attach_node( parent, new LeafNode( action, best_class ) );
+  }
+
+  // Not finished splitting. Every process takes the same branch, so the
+  // recursion (and the reductions in it) stays in step.
+  else
+  {
+    Node * split = new SplitNode( action, highest_ig_column, highest_ig_threshold );
+
+    unsigned int split_row = data.partition( highest_ig_column, highest_ig_threshold );
+    Dataset data_le( data, 0, split_row );
+    Dataset data_g( data, split_row, data.row_count() );
+
+    stringstream action_le;
+    action_le << highest_ig_column_str << " <= " << highest_ig_threshold;
+    _grow_decision_tree_distributed(
+      data_le, split_keys, keys_per_node,
+      decision_column, random, reducer, split, action_le.str() );
+
+    stringstream action_g;
+    action_g << highest_ig_column_str << " > " << highest_ig_threshold;
+    _grow_decision_tree_distributed(
+      data_g, split_keys, keys_per_node,
+      decision_column, random, reducer, split, action_g.str() );
+
+    attach_node( parent, split );
   }
 }
 
-//------------------------------------------------------------------------------
+//---------
 
-bool RandomTree::classify( const double * const & row ) const
+Dataset::KeyList RandomTree::choose_keys(
+  const Dataset::KeyList & split_keys,
+  const unsigned int keys_per_node,
+  RandomStream & random )
 {
-  // Classify.
-  Node * next_node = root;
-  while ( next_node != null(Node) )
+  Dataset::KeyList sample_keys;
+  while ( sample_keys.size() < keys_per_node )
   {
-    // Leaf?
-    if ( next_node->is_leaf() )
+    unsigned int index = random.uniform( split_keys.size() );
+    Dataset::KeyList::const_iterator iter = split_keys.begin();
+    unsigned int index_dec = index;
+    while ( index_dec-- )
+    {
+      ++iter;
+    }
+    if ( sample_keys.find(iter->first) == sample_keys.end() )
     {
-      return next_node->get_classification();
+      sample_keys[iter->first] = iter->second;
     }
+  }
+  return sample_keys;
+}
+
+//---------
 
-    // Not a leaf. Must be a split.
+void RandomTree::attach_node( Node * const parent, Node * const node )
+{
+  if ( parent == null(Node) )
+  {
+    root = node;
+  }
+  else
+  {
+    parent->add_child(node);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void RandomTree::compile( void )
+{
+  nodes.clear();
+  compiled = null(CompiledNode);
+  compiled_count = 0;
+  if ( root == null(Node) )
+  {
+    return;
+  }
+
+  // Breadth-first, appending both children of a split at once so they are
+  // adjacent.
+  vector<Node*> open_list;
+  open_list.push_back( root );
+  nodes.resize( 1 );
+  for ( unsigned int index = 0; index < open_list.size(); ++index )
+  {
+    Node * node = open_list[index];
+    CompiledNode & packed = nodes[index];
+    packed.threshold = 0.0;
+
+    Node::NodeSet children = node->get_children();
+    if ( node->is_leaf() || (children.size() != 2u) )
+    {
+      // A split without exactly two children can't classify; treat it as a
+      // negative leaf.
+      packed.column = LeafColumn;
+      packed.child = ( node->is_leaf() && node->get_classification() ) ? 1 : 0;
+    }
     else
     {
-      SplitNode *split = reinterpret_cast<SplitNode*>(next_node);
-      unsigned int split_column = split->get_column();
-      double split_threshold = split->get_threshold();
+      SplitNode *split = reinterpret_cast<SplitNode*>(node);
+      packed.column = split->get_column();
+      packed.threshold = split->get_threshold();
+      packed.child = open_list.size();
+      open_list.push_back( children[0] );
+      open_list.push_back( children[1] );
+      nodes.resize( open_list.size() );
+    }
+  }
+  compiled = &nodes[0];
+  compiled_count = nodes.size();
+}
 
-      // Get children.
-      Node::NodeSet children = split->get_children();
+//------------------------------------------------------------------------------
 
-      // Two children?
-      if ( children.size() == 2u )
-      {
-        // Move to correct child.
-        unsigned int child_index = (row[split_column] > split_threshold) ? 1 : 0;
-        next_node = children[child_index];
-      }
+Node * RandomTree::decompile( const unsigned int index, const std::string & action ) const
+{
+  if ( compiled == null(CompiledNode) )
+  {
+    return new LeafNode( action, false );
+  }
+  const CompiledNode & packed = compiled[index];
+  if ( packed.column == LeafColumn )
+  {
+    return new LeafNode( action, packed.child != 0 );
+  }
 
-      // < than or > than two children? Odd...
-      else
+  // Compiled nodes keep no key names; the actions name the columns.
+  Node * split = new SplitNode( action, packed.column, packed.threshold );
+  stringstream action_le;
+  action_le << packed.column << " <= " << packed.threshold;
+  split->add_child( decompile( packed.child, action_le.str() ) );
+  stringstream action_g;
+  action_g << packed.column << " > " << packed.threshold;
+  split->add_child( decompile( packed.child + 1, action_g.str() ) );
+  return split;
+}
+
+//------------------------------------------------------------------------------
+
+void RandomTree::vote_batch(
+  const Dataset & data,
+  const unsigned int begin,
+  const unsigned int end,
+  unsigned int * const votes ) const
+{
+  if ( compiled == null(CompiledNode) )
+  {
+    return;
+  }
+
+  // Row-major rows can be walked through a row pointer.
+  if ( data.data_matrix().get_layout() == Dataset::RowMajor )
+  {
+    for ( unsigned int row = begin; row < end; ++row )
+    {
+      if ( classify( data[row] ) )
       {
-        return false;
+        ++votes[row - begin];
       }
     }
+    return;
   }
 
-  // Nothing found? ... Odd...
-  return false;
+  // Otherwise read each element through the dataset.
+  for ( unsigned int row = begin; row < end; ++row )
+  {
+    const CompiledNode * node = compiled;
+    while ( node->column != LeafColumn )
+    {
+      node = &compiled[node->child + ((data.get(row, node->column) > node->threshold) ? 1 : 0)];
+    }
+    if ( node->child != 0 )
+    {
+      ++votes[row - begin];
+    }
+  }
 }
 
 //------------------------------------------------------------------------------
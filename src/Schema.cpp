@@ -0,0 +1,306 @@
+/*
+ * Schema.cpp
+ */
+
+#include "Schema.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+
+using namespace std;
+
+namespace
+{
+  /**
+   * Parse a whole field index or count.
+   * @param value The text.
+   * @param [out] number The value.
+   * @return False if the text isn't a number.
+   */
+  bool parse_unsigned( const string & value, unsigned int & number )
+  {
+    if ( value.empty() || (value[0] < '0') || (value[0] > '9') )
+    {
+      return false;
+    }
+    char * end = null(char);
+    number = static_cast<unsigned int>( strtoul( value.c_str(), &end, 10 ) );
+    return *end == '\0';
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Schema::Schema( void ) :
+  delimiter( '\t' ),
+  id_column( TextLoader::NoColumn ),
+  label_column( 0 ),
+  columns( 0 ),
+  header( false ),
+  label_threshold( false ),
+  positive_max( 0.0 )
+{
+  //
+}
+
+//------------------------------------------------------------------------------
+
+bool Schema::read( const std::string & filename )
+{
+  ifstream file( filename.c_str() );
+  return file.is_open() && read( file );
+}
+
+//------------------------------------------------------------------------------
+
+bool Schema::read( std::istream & stream )
+{
+  // Names given here replace any there were.
+  bool named = false;
+  string line;
+  while ( getline( stream, line ) )
+  {
+    if ( !line.empty() && (line[line.size() - 1] == '\r') )
+    {
+      line.erase( line.size() - 1 );
+    }
+    if ( line.empty() || (line[0] == '#') )
+    {
+      continue;
+    }
+    size_t equals = line.find( '=' );
+    if ( equals == string::npos )
+    {
+      return false;
+    }
+    string name = line.substr( 0, equals );
+    string value = line.substr( equals + 1 );
+
+    unsigned int number = 0;
+    if ( name == "delimiter" )
+    {
+      if ( value == "tab" )
+      {
+        delimiter = '\t';
+      }
+      else if ( value.size() == 1 )
+      {
+        delimiter = value[0];
+      }
+      else
+      {
+        return false;
+      }
+    }
+    else if ( (name == "id-column") && (value == "none") )
+    {
+      id_column = TextLoader::NoColumn;
+    }
+    else if ( (name == "id-column") && parse_unsigned( value, number ) )
+    {
+      id_column = number;
+    }
+    else if ( (name == "label-column") && parse_unsigned( value, number ) )
+    {
+      label_column = number;
+    }
+    else if ( (name == "columns") && parse_unsigned( value, number ) )
+    {
+      columns = number;
+    }
+    else if ( (name == "header") && parse_unsigned( value, number ) && (number <= 1) )
+    {
+      header = ( number == 1 );
+    }
+    else if ( (name == "positive-max") && (value == "none") )
+    {
+      label_threshold = false;
+      positive_max = 0.0;
+    }
+    else if ( name == "positive-max" )
+    {
+      char * end = null(char);
+      double number = strtod( value.c_str(), &end );
+      if ( value.empty() || (*end != '\0') )
+      {
+        return false;
+      }
+      label_threshold = true;
+      positive_max = number;
+    }
+    else if ( name == "name" )
+    {
+      if ( !named )
+      {
+        names.clear();
+        named = true;
+      }
+      names.push_back( value );
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void Schema::write( std::ostream & stream ) const
+{
+  if ( delimiter == '\t' )
+  {
+    stream << "delimiter=tab\n";
+  }
+  else
+  {
+    stream << "delimiter=" << delimiter << "\n";
+  }
+  if ( id_column == TextLoader::NoColumn )
+  {
+    stream << "id-column=none\n";
+  }
+  else
+  {
+    stream << "id-column=" << id_column << "\n";
+  }
+  stream
+    << "label-column=" << label_column << "\n"
+    << "columns=" << columns << "\n"
+    << "header=" << ( header ? 1 : 0 ) << "\n";
+  if ( label_threshold )
+  {
+    streamsize precision = stream.precision( 17 );
+    stream << "positive-max=" << positive_max << "\n";
+    stream.precision( precision );
+  }
+  else
+  {
+    stream << "positive-max=none\n";
+  }
+  for ( unsigned int column = 0; column < names.size(); ++column )
+  {
+    stream << "name=" << names[column] << "\n";
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Schema::configure( TextLoader & loader ) const
+{
+  loader.set_delimiter( delimiter );
+  loader.set_id_column( id_column );
+  loader.set_label_column( label_column );
+  loader.set_column_count( columns );
+  loader.set_header( header );
+  loader.set_label_threshold( label_threshold, positive_max );
+}
+
+//------------------------------------------------------------------------------
+
+DataFile::Source Schema::source( void ) const
+{
+  DataFile::Source source;
+  source.delimiter = static_cast<unsigned char>( delimiter );
+  source.id_field = ( id_column == TextLoader::NoColumn ) ? DataFile::NoField : id_column;
+  source.label_field = label_column;
+  source.header_line = header ? 1 : 0;
+  source.label_threshold = label_threshold ? 1 : 0;
+  source.reserved = 0;
+  source.positive_max = positive_max;
+  return source;
+}
+
+//------------------------------------------------------------------------------
+
+bool Schema::matches( const ColumnFile & file ) const
+{
+  DataFile::Source expected = source();
+  const DataFile::Source & actual = file.get_source();
+  return
+    ( actual.delimiter == expected.delimiter ) &&
+    ( actual.id_field == expected.id_field ) &&
+    ( actual.label_field == expected.label_field ) &&
+    ( actual.header_line == expected.header_line ) &&
+    ( actual.label_threshold == expected.label_threshold ) &&
+    ( actual.positive_max == expected.positive_max ) &&
+    ( (columns == 0) || (file.column_count() == columns) );
+}
+
+//------------------------------------------------------------------------------
+
+void Schema::infer( const TextLoader & loader )
+{
+  if ( columns == 0 )
+  {
+    columns = loader.column_count();
+  }
+  vector<string> column_names;
+  loader.column_names( column_names );
+  complete_names( column_names );
+}
+
+//------------------------------------------------------------------------------
+
+void Schema::infer( const ColumnFile & file )
+{
+  if ( columns == 0 )
+  {
+    columns = file.column_count();
+  }
+  vector<string> column_names( file.column_count() );
+  const Dataset::KeyList & keys = file.get_keys();
+  for (
+    Dataset::KeyList::const_iterator key = keys.begin();
+    key != keys.end();
+    ++key )
+  {
+    if ( key->second < column_names.size() )
+    {
+      column_names[key->second] = key->first;
+    }
+  }
+  complete_names( column_names );
+}
+
+//------------------------------------------------------------------------------
+
+void Schema::name_keys( Dataset::KeyList & keys ) const
+{
+  for ( unsigned int column = 0; column < names.size(); ++column )
+  {
+    keys[names[column]] = column;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Schema::complete_names( const std::vector<std::string> & column_names )
+{
+  names.resize( columns );
+  for ( unsigned int column = 0; column < columns; ++column )
+  {
+    if ( !names[column].empty() )
+    {
+      continue;
+    }
+    if ( (column < column_names.size()) && !column_names[column].empty() )
+    {
+      names[column] = column_names[column];
+    }
+    else if ( column == 0 )
+    {
+      names[column] = "class";
+    }
+    else
+    {
+      stringstream feature_ident;
+      feature_ident << "f" << column;
+      names[column] = feature_ident.str();
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
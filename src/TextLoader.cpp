@@ -0,0 +1,552 @@
+/*
+ * TextLoader.cpp
+ */
+
+#include "TextLoader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+TextLoader::TextLoader( void ) :
+  data( null(const char) ),
+  size( 0 ),
+  body( null(const char) ),
+  position( null(const char) ),
+  fields( 0 ),
+  header( false ),
+  columns( 0 ),
+  delimiter( '\t' ),
+  id_column( NoColumn ),
+  label_column( 0 ),
+  label_function( reinterpret_cast<LabelFunction>(0) ),
+  label_threshold( false ),
+  positive_max( 0.0 ),
+  thread_count( 1 ),
+  line_bytes( 0 )
+{
+  //
+}
+
+//------------------------------------------------------------------------------
+
+bool TextLoader::open( const std::string & filename )
+{
+  close();
+
+  int descriptor = ::open( filename.c_str(), O_RDONLY );
+  if ( descriptor < 0 )
+  {
+    return false;
+  }
+  struct stat status;
+  bool mapped = ( fstat( descriptor, &status ) == 0 );
+  if ( mapped && (status.st_size > 0) )
+  {
+    void * map = mmap(
+      null(void), status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0 );
+    mapped = ( map != MAP_FAILED );
+    if ( mapped )
+    {
+      data = reinterpret_cast<const char*>(map);
+      size = status.st_size;
+
+      // The file is read front to back.
+      madvise( map, size, MADV_SEQUENTIAL );
+    }
+  }
+  ::close( descriptor );
+  if ( !mapped )
+  {
+    return false;
+  }
+
+  // Count the fields of the first line, and name them if it's a header.
+  body = data;
+  rewind();
+  const char * begin = null(const char);
+  const char * end = null(const char);
+  if ( find_line( position, begin, end ) )
+  {
+    fields = 1;
+    for ( const char * c = begin; c < end; ++c )
+    {
+      if ( *c == delimiter )
+      {
+        ++fields;
+      }
+    }
+    if ( end[-1] == delimiter )
+    {
+      --fields;
+    }
+    line_bytes = position - begin;
+    if ( header )
+    {
+      const char * field_begin = begin;
+      for ( unsigned int field = 0; field < fields; ++field )
+      {
+        const char * field_end = reinterpret_cast<const char*>(
+          memchr( field_begin, delimiter, end - field_begin ) );
+        if ( field_end == null(const char) )
+        {
+          field_end = end;
+        }
+        field_names.push_back( string(field_begin, field_end) );
+        field_begin = field_end + 1;
+      }
+      body = position;
+      if ( find_line( position, begin, end ) )
+      {
+        line_bytes = position - begin;
+      }
+    }
+  }
+  rewind();
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void TextLoader::close( void )
+{
+  if ( data != null(const char) )
+  {
+    munmap( const_cast<char*>(data), size );
+  }
+  data = null(const char);
+  size = 0;
+  body = null(const char);
+  position = null(const char);
+  fields = 0;
+  field_names.clear();
+  line_bytes = 0;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int TextLoader::column_count( void ) const
+{
+  if ( columns > 0 )
+  {
+    return columns;
+  }
+  return ( (id_column < fields) && (fields > 0) ) ? fields - 1 : fields;
+}
+
+//------------------------------------------------------------------------------
+
+void TextLoader::column_names( vector<string> & names ) const
+{
+  names.clear();
+  if ( field_names.empty() )
+  {
+    return;
+  }
+  unsigned int columns = column_count();
+  names.resize( columns );
+  if ( label_column < field_names.size() )
+  {
+    names[0] = field_names[label_column];
+  }
+  unsigned int column = 1;
+  for ( unsigned int field = 0; (field < field_names.size()) && (column < columns); ++field )
+  {
+    if ( (field != label_column) && (field != id_column) )
+    {
+      names[column++] = field_names[field];
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+unsigned long TextLoader::count_rows( void ) const
+{
+  size_t bytes = data + size - body;
+  unsigned int chunk_count = threads();
+  if ( bytes / MinChunkBytes < chunk_count )
+  {
+    chunk_count = static_cast<unsigned int>( bytes / MinChunkBytes );
+  }
+  if ( chunk_count <= 1 )
+  {
+    return count_lines( body, data + size );
+  }
+
+  vector<Chunk> chunks;
+  split( body, bytes, chunk_count, chunks );
+  ThreadPool pool( chunk_count );
+  ChunkCountTask task( *this, chunks );
+  pool.run( task, chunks.size() );
+  unsigned long rows = 0;
+  for ( unsigned int chunk = 0; chunk < chunks.size(); ++chunk )
+  {
+    rows += chunks[chunk].rows;
+  }
+  return rows;
+}
+
+//------------------------------------------------------------------------------
+
+bool TextLoader::next_row( double * const row )
+{
+  const char * begin = null(const char);
+  const char * end = null(const char);
+  if ( !next_line( begin, end ) )
+  {
+    return false;
+  }
+  parse_line( begin, end, row );
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool TextLoader::skip_row( void )
+{
+  const char * begin = null(const char);
+  const char * end = null(const char);
+  return next_line( begin, end );
+}
+
+//------------------------------------------------------------------------------
+
+unsigned long TextLoader::read( Dataset::RealMatrix & matrix )
+{
+  const char * file_end = data + size;
+  unsigned int thread_limit = threads();
+  unsigned long rows = 0;
+  const char * start = position;
+  vector<Chunk> chunks;
+  while ( (rows < matrix.row_count()) && (position < file_end) )
+  {
+    // Size the window to the rows still wanted, from the line length so far.
+    unsigned long wanted = matrix.row_count() - rows;
+    size_t average = ( rows > 0 ) ? (position - start) / rows + 1 : line_bytes + 1;
+    size_t remaining = file_end - position;
+    size_t window = ( wanted < remaining / average ) ? (wanted + 1) * average : remaining;
+    unsigned int chunk_count = thread_limit;
+    if ( window / MinChunkBytes < chunk_count )
+    {
+      chunk_count = static_cast<unsigned int>( window / MinChunkBytes );
+    }
+    if ( chunk_count == 0 )
+    {
+      chunk_count = 1;
+    }
+    split( position, window, chunk_count, chunks );
+
+    // Count the rows of every chunk to find where each one starts.
+    if ( chunks.size() > 1 )
+    {
+      ThreadPool pool( chunks.size() );
+      ChunkCountTask task( *this, chunks );
+      pool.run( task, chunks.size() );
+    }
+    else
+    {
+      chunks[0].rows = count_lines( chunks[0].begin, chunks[0].end );
+    }
+    unsigned int parse_count = 0;
+    for ( unsigned int chunk = 0; (chunk < chunks.size()) && (rows < matrix.row_count()); ++chunk )
+    {
+      chunks[chunk].first_row = rows;
+      chunks[chunk].parse_rows =
+        min( chunks[chunk].rows, static_cast<unsigned long>(matrix.row_count()) - rows );
+      rows += chunks[chunk].parse_rows;
+      ++parse_count;
+    }
+
+    // Parse them. Where the last parsed chunk stopped is the next row.
+    if ( parse_count > 1 )
+    {
+      ThreadPool pool( parse_count );
+      ChunkParseTask task( *this, chunks, matrix );
+      pool.run( task, parse_count );
+    }
+    else if ( parse_count == 1 )
+    {
+      parse_chunk( chunks[0], matrix );
+    }
+    position = chunks[parse_count - 1].next;
+  }
+  return rows;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned long TextLoader::read_selected(
+  Dataset::RealMatrix & matrix,
+  const std::vector<bool> & keep )
+{
+  // Find the lines. Looking for line ends is cheap next to parsing, so the
+  // lines that aren't kept cost little.
+  vector<Line> lines;
+  size_t bytes = 0;
+  unsigned long passed = 0;
+  Line line = { null(const char), null(const char) };
+  for ( ; (passed < keep.size()) && next_line( line.begin, line.end ); ++passed )
+  {
+    if ( keep[passed] )
+    {
+      lines.push_back( line );
+      bytes += line.end - line.begin;
+    }
+  }
+
+  // Parse the kept ones, an even share per thread.
+  unsigned int task_count = threads();
+  if ( bytes / MinChunkBytes < task_count )
+  {
+    task_count = static_cast<unsigned int>( bytes / MinChunkBytes );
+  }
+  if ( task_count > 1 )
+  {
+    ThreadPool pool( task_count );
+    LineParseTask task( *this, lines, task_count, matrix );
+    pool.run( task, task_count );
+  }
+  else
+  {
+    parse_lines( lines, 0, lines.size(), matrix );
+  }
+  return passed;
+}
+
+//------------------------------------------------------------------------------
+
+bool TextLoader::find_line(
+  const char * & next,
+  const char * const limit,
+  const char * & begin,
+  const char * & end ) const
+{
+  while ( next < limit )
+  {
+    const char * line_end = reinterpret_cast<const char*>(
+      memchr( next, '\n', limit - next ) );
+    if ( line_end == null(const char) )
+    {
+      line_end = limit;
+    }
+    begin = next;
+    end = line_end;
+    next = ( line_end < limit ) ? line_end + 1 : limit;
+
+    if ( (end > begin) && (end[-1] == '\r') )
+    {
+      --end;
+    }
+    if ( end > begin )
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
+bool TextLoader::next_line( const char * & begin, const char * & end )
+{
+  return find_line( position, begin, end );
+}
+
+//------------------------------------------------------------------------------
+
+void TextLoader::parse_line(
+  const char * begin,
+  const char * const end,
+  double * const row ) const
+{
+  unsigned int columns = column_count();
+  for ( unsigned int column = 0; column < columns; ++column )
+  {
+    row[column] = 0.0;
+  }
+
+  // The label goes first, then the features in file order.
+  unsigned int field = 0;
+  unsigned int column = 1;
+  const char * field_begin = begin;
+  while ( true )
+  {
+    const char * field_end = reinterpret_cast<const char*>(
+      memchr( field_begin, delimiter, end - field_begin ) );
+    if ( field_end == null(const char) )
+    {
+      field_end = end;
+    }
+
+    if ( field == label_column )
+    {
+      double value = parse_field( field_begin, field_end );
+      if ( label_threshold )
+      {
+        row[0] = ( value <= positive_max ) ? 1.0 : 0.0;
+      }
+      else
+      {
+        row[0] = ( label_function != reinterpret_cast<LabelFunction>(0) ) ?
+          label_function( value ) : value;
+      }
+    }
+    else if ( (field != id_column) && (column < columns) )
+    {
+      row[column++] = parse_field( field_begin, field_end );
+    }
+    ++field;
+
+    // A delimiter at the end of the line ends the line.
+    if ( (field_end == end) || (field_end + 1 == end) )
+    {
+      break;
+    }
+    field_begin = field_end + 1;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+unsigned long TextLoader::count_lines(
+  const char * begin,
+  const char * const end ) const
+{
+  unsigned long lines = 0;
+  const char * line_begin = null(const char);
+  const char * line_end = null(const char);
+  while ( find_line( begin, end, line_begin, line_end ) )
+  {
+    ++lines;
+  }
+  return lines;
+}
+
+//------------------------------------------------------------------------------
+
+void TextLoader::split(
+  const char * const begin,
+  const size_t bytes,
+  const unsigned int chunk_count,
+  vector<Chunk> & chunks ) const
+{
+  // Move every nominal boundary on past the end of its line.
+  const char * file_end = data + size;
+  chunks.clear();
+  const char * chunk_begin = begin;
+  for ( unsigned int chunk = 1; chunk <= chunk_count; ++chunk )
+  {
+    const char * boundary = begin + bytes * chunk / chunk_count;
+    if ( boundary < chunk_begin )
+    {
+      continue;
+    }
+    if ( boundary > begin )
+    {
+      --boundary;
+    }
+    const char * line_end = reinterpret_cast<const char*>(
+      memchr( boundary, '\n', file_end - boundary ) );
+    boundary = ( line_end != null(const char) ) ? line_end + 1 : file_end;
+    if ( boundary > chunk_begin )
+    {
+      Chunk next_chunk = { chunk_begin, boundary, boundary, 0, 0, 0 };
+      chunks.push_back( next_chunk );
+      chunk_begin = boundary;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void TextLoader::parse_chunk( Chunk & chunk, Dataset::RealMatrix & matrix ) const
+{
+  const char * begin = null(const char);
+  const char * end = null(const char);
+  chunk.next = chunk.begin;
+  if ( matrix.get_layout() == Dataset::RowMajor )
+  {
+    for ( unsigned long row = 0; row < chunk.parse_rows; ++row )
+    {
+      find_line( chunk.next, chunk.end, begin, end );
+      parse_line( begin, end, matrix[chunk.first_row + row] );
+    }
+  }
+  else
+  {
+    vector<double> values( column_count() );
+    for ( unsigned long row = 0; row < chunk.parse_rows; ++row )
+    {
+      find_line( chunk.next, chunk.end, begin, end );
+      parse_line( begin, end, &values[0] );
+      for ( unsigned int column = 0; column < values.size(); ++column )
+      {
+        matrix.at( chunk.first_row + row, column ) = values[column];
+      }
+    }
+  }
+
+  // A chunk read to the end leaves nothing to come back for.
+  if ( chunk.parse_rows == chunk.rows )
+  {
+    chunk.next = chunk.end;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void TextLoader::parse_lines(
+  const std::vector<Line> & lines,
+  const unsigned long first,
+  const unsigned long last,
+  Dataset::RealMatrix & matrix ) const
+{
+  if ( matrix.get_layout() == Dataset::RowMajor )
+  {
+    for ( unsigned long line = first; line < last; ++line )
+    {
+      parse_line( lines[line].begin, lines[line].end, matrix[line] );
+    }
+  }
+  else
+  {
+    vector<double> values( column_count() );
+    for ( unsigned long line = first; line < last; ++line )
+    {
+      parse_line( lines[line].begin, lines[line].end, &values[0] );
+      for ( unsigned int column = 0; column < values.size(); ++column )
+      {
+        matrix.at( line, column ) = values[column];
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+double TextLoader::parse_field( const char * begin, const char * const end )
+{
+  // from_chars() takes neither leading blanks nor a plus sign.
+  while ( (begin < end) && ((*begin == ' ') || (*begin == '\t')) )
+  {
+    ++begin;
+  }
+  if ( (begin < end) && (*begin == '+') )
+  {
+    ++begin;
+  }
+  double value = 0.0;
+  from_chars( begin, end, value );
+  return value;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,133 @@
+/*
+ * ThreadPool.cpp
+ */
+
+#include "ThreadPool.h"
+
+#include <iostream>
+#include <unistd.h>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+ThreadPool::ThreadPool( const unsigned int thread_count ) :
+  workers( (thread_count > 0) ? thread_count : hardware_concurrency() ),
+  queues( workers.size() ),
+  task( reinterpret_cast<Task*>(0) ),
+  running( false )
+{
+  for ( unsigned int id = 0; id < workers.size(); ++id )
+  {
+    workers[id].pool = this;
+    workers[id].id = id;
+    workers[id].started = false;
+    queues[id] = new WorkQueue;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+ThreadPool::~ThreadPool( void )
+{
+  join();
+  for ( unsigned int id = 0; id < queues.size(); ++id )
+  {
+    delete queues[id];
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ThreadPool::start( Task & task, const unsigned int task_count )
+{
+  // Finish any previous run.
+  join();
+
+  // Deal the task indices.
+  this->task = &task;
+  for ( unsigned int index = 0; index < task_count; ++index )
+  {
+    queues[index % queues.size()]->push( index );
+  }
+
+  // Spawn the threads. Workers steal from every queue, so the threads that
+  // start take over the indices dealt to any that don't.
+  bool any_started = false;
+  for ( unsigned int id = 0; id < workers.size(); ++id )
+  {
+    workers[id].started = ( pthread_create(
+      &workers[id].thread, NULL, ThreadPool::route,
+      reinterpret_cast<void*>(&workers[id]) ) == 0 );
+    any_started = any_started || workers[id].started;
+  }
+  running = true;
+
+  // No threads at all: do the work here.
+  if ( !any_started )
+  {
+    cerr << "ThreadPool: Can't create threads, running on the calling thread." << endl;
+    work( 0 );
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ThreadPool::join( void )
+{
+  if ( running )
+  {
+    for ( unsigned int id = 0; id < workers.size(); ++id )
+    {
+      if ( workers[id].started )
+      {
+        pthread_join( workers[id].thread, NULL );
+        workers[id].started = false;
+      }
+    }
+    running = false;
+    task = reinterpret_cast<Task*>(0);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int ThreadPool::hardware_concurrency( void )
+{
+  long processors = sysconf( _SC_NPROCESSORS_ONLN );
+  return ( processors > 0 ) ? static_cast<unsigned int>(processors) : 1;
+}
+
+//------------------------------------------------------------------------------
+
+void * ThreadPool::route( void * worker_pointer )
+{
+  Worker *worker = reinterpret_cast<Worker*>(worker_pointer);
+  worker->pool->work( worker->id );
+  return reinterpret_cast<void*>(0);
+}
+
+//------------------------------------------------------------------------------
+
+void ThreadPool::work( const unsigned int worker_id )
+{
+  unsigned int queue_count = queues.size();
+  unsigned int index = 0;
+  while ( true )
+  {
+    // Own queue first, then steal. No tasks are added while running, so once
+    // every queue is empty the work is done.
+    bool found = queues[worker_id]->pop( index );
+    for ( unsigned int offset = 1; !found && (offset < queue_count); ++offset )
+    {
+      found = queues[(worker_id + offset) % queue_count]->steal( index );
+    }
+    if ( !found )
+    {
+      break;
+    }
+    task->run( index );
+  }
+}
+
+//------------------------------------------------------------------------------
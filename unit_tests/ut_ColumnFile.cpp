@@ -0,0 +1,236 @@
+/*
+ * ut_ColumnFile.cpp
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "ut_ColumnFile.h"
+#include "ColumnFile.h"
+#include "TextLoader.h"
+
+#include <fstream>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ut_ColumnFile );
+
+namespace ut_ColumnFile_ns
+{
+  const char * const Filename = "data/output/column_file_test.rfd";
+  const char * const TextFilename = "data/output/column_file_test.csv";
+}
+
+//------------------------------------------------------------------------------
+
+void ut_ColumnFile::testMethod_write( void )
+{
+  using namespace ut_ColumnFile_ns;
+
+  // Write a row-major matrix.
+  Dataset::RealMatrix matrix( 3, 2 );
+  matrix.at(0, 0) = 1; matrix.at(0, 1) = 0.5;
+  matrix.at(1, 0) = 0; matrix.at(1, 1) = -2;
+  matrix.at(2, 0) = 1; matrix.at(2, 1) = 7.25;
+  Dataset::KeyList keys;
+  keys["class"] = 0;
+  keys["width"] = 1;
+  CPPUNIT_ASSERT( ColumnFile::write( Filename, matrix, keys ) );
+
+  // Map it back as a column-major matrix.
+  ColumnFile file;
+  CPPUNIT_ASSERT( file.open( Filename ) );
+  CPPUNIT_ASSERT_EQUAL( 2u, file.column_count() );
+  CPPUNIT_ASSERT_EQUAL( 3ul, file.count_rows() );
+  CPPUNIT_ASSERT_EQUAL( 0u, file.get_label_column() );
+  CPPUNIT_ASSERT( file.get_keys() == keys );
+  Dataset::RealMatrix & mapped = file.get_matrix();
+  CPPUNIT_ASSERT( mapped.get_layout() == Dataset::ColumnMajor );
+  CPPUNIT_ASSERT_EQUAL( 0u, static_cast<unsigned int>(
+    reinterpret_cast<size_t>(mapped.column_data(0)) % DataFile::ColumnAlignment) );
+  for ( unsigned int row = 0; row < 3; ++row )
+  {
+    for ( unsigned int column = 0; column < 2; ++column )
+    {
+      CPPUNIT_ASSERT_EQUAL( matrix.at(row, column), mapped.at(row, column) );
+    }
+  }
+
+  // Read it as rows.
+  double row[2];
+  CPPUNIT_ASSERT( file.skip_row() );
+  CPPUNIT_ASSERT( file.next_row( row ) );
+  CPPUNIT_ASSERT_EQUAL( 0.0, row[0] );
+  CPPUNIT_ASSERT_EQUAL( -2.0, row[1] );
+  Dataset::RealMatrix rest( 5, 2 );
+  CPPUNIT_ASSERT_EQUAL( 1ul, file.read( rest ) );
+  CPPUNIT_ASSERT_EQUAL( 7.25, rest.at(0, 1) );
+  CPPUNIT_ASSERT( !file.next_row( row ) );
+  file.rewind();
+  CPPUNIT_ASSERT( file.next_row( row ) );
+  CPPUNIT_ASSERT_EQUAL( 0.5, row[1] );
+
+  // Read only the selected rows, up to the end.
+  vector<bool> keep( 3, true );
+  keep[0] = false;
+  Dataset::RealMatrix selected( 3, 2 );
+  CPPUNIT_ASSERT_EQUAL( 2ul, file.read_selected( selected, keep ) );
+  CPPUNIT_ASSERT_EQUAL( 7.25, selected.at(0, 1) );
+  file.rewind();
+  CPPUNIT_ASSERT_EQUAL( 3ul, file.read_selected( selected, keep ) );
+  CPPUNIT_ASSERT_EQUAL( -2.0, selected.at(0, 1) );
+  CPPUNIT_ASSERT_EQUAL( 7.25, selected.at(1, 1) );
+
+  // Writes to the matrix don't reach the file.
+  mapped.at(0, 1) = 99.0;
+  ColumnFile again;
+  CPPUNIT_ASSERT( again.open( Filename ) );
+  CPPUNIT_ASSERT_EQUAL( 0.5, again.get_matrix().at(0, 1) );
+
+  file.close();
+  CPPUNIT_ASSERT_EQUAL( 0u, file.column_count() );
+  remove( Filename );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_ColumnFile::testMethod_convert( void )
+{
+  using namespace ut_ColumnFile_ns;
+
+  {
+    ofstream text( TextFilename, ios_base::out | ios_base::binary );
+    text << "a\t1\t2.5\t9\nb\t0\t-1\t9\n";
+  }
+  TextLoader loader;
+  loader.set_id_column( 0 );
+  loader.set_label_column( 1 );
+  loader.set_column_count( 2 );
+  CPPUNIT_ASSERT( loader.open( TextFilename ) );
+  Dataset::KeyList keys;
+  keys["class"] = 0;
+  keys["f1"] = 1;
+  CPPUNIT_ASSERT( ColumnFile::convert( loader, Filename, keys ) );
+
+  ColumnFile file;
+  CPPUNIT_ASSERT( file.open( Filename ) );
+  CPPUNIT_ASSERT_EQUAL( 2u, file.column_count() );
+  CPPUNIT_ASSERT_EQUAL( 2ul, file.count_rows() );
+  CPPUNIT_ASSERT_EQUAL( 1.0, file.get_matrix().at(0, 0) );
+  CPPUNIT_ASSERT_EQUAL( 2.5, file.get_matrix().at(0, 1) );
+  CPPUNIT_ASSERT_EQUAL( -1.0, file.get_matrix().at(1, 1) );
+
+  // Rows past the first blocks land in place in every column, whatever has
+  // been read already.
+  const unsigned int rows = 2 * ColumnFile::ConvertBlockRows + 3;
+  {
+    ofstream text( TextFilename, ios_base::out | ios_base::binary );
+    for ( unsigned int row = 0; row < rows; ++row )
+    {
+      text << "r\t" << row % 2 << "\t" << row << "\t9\n";
+    }
+  }
+  CPPUNIT_ASSERT( loader.open( TextFilename ) );
+  double first[2];
+  CPPUNIT_ASSERT( loader.next_row( first ) );
+  CPPUNIT_ASSERT( ColumnFile::convert( loader, Filename, keys ) );
+  CPPUNIT_ASSERT( file.open( Filename ) );
+  CPPUNIT_ASSERT_EQUAL( static_cast<unsigned long>(rows), file.count_rows() );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    CPPUNIT_ASSERT_EQUAL( static_cast<double>(row % 2), file.get_matrix().at(row, 0) );
+    CPPUNIT_ASSERT_EQUAL( static_cast<double>(row), file.get_matrix().at(row, 1) );
+  }
+  file.close();
+
+  remove( TextFilename );
+  remove( Filename );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_ColumnFile::testMethod_open_invalid( void )
+{
+  using namespace ut_ColumnFile_ns;
+
+  ColumnFile file;
+  CPPUNIT_ASSERT( !file.open( "data/output/no_such_file.rfd" ) );
+
+  // Not a column file.
+  {
+    ofstream text( Filename, ios_base::out | ios_base::binary );
+    text << "class\tf1\n1\t2\n";
+  }
+  CPPUNIT_ASSERT( !file.open( Filename ) );
+
+  // Truncated column blocks.
+  Dataset::RealMatrix matrix( 100, 3 );
+  CPPUNIT_ASSERT( ColumnFile::write( Filename, matrix, Dataset::KeyList() ) );
+  CPPUNIT_ASSERT( file.open( Filename ) );
+  file.close();
+  CPPUNIT_ASSERT_EQUAL( 0, truncate( Filename, 1000 ) );
+  CPPUNIT_ASSERT( !file.open( Filename ) );
+  CPPUNIT_ASSERT_EQUAL( 0ul, file.count_rows() );
+
+  remove( Filename );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_ColumnFile::testMethod_train_mapped( void )
+{
+  using namespace ut_ColumnFile_ns;
+
+  // Enough rows that the columns span several pages.
+  const unsigned int rows = 5000;
+  Dataset::RealMatrix matrix( rows, 3, Dataset::ColumnMajor );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    matrix.at(row, 0) = ( row % 3 == 0 ) ? 1.0 : 0.0;
+    matrix.at(row, 1) = ( row * 7919 ) % 1000;
+    matrix.at(row, 2) = row % 17;
+  }
+  CPPUNIT_ASSERT( !matrix.is_mapped() );
+  CPPUNIT_ASSERT( ColumnFile::write( Filename, matrix, Dataset::KeyList() ) );
+
+  ColumnFile file;
+  CPPUNIT_ASSERT( file.open( Filename ) );
+  Dataset::RealMatrix & mapped = file.get_matrix();
+  CPPUNIT_ASSERT( mapped.is_mapped() );
+
+  // Hints don't change what is read, whatever the rows.
+  Dataset in_memory( matrix, rows / 2 );
+  Dataset from_file( mapped, rows / 2 );
+  for ( unsigned int row = 0; row < rows / 2; ++row )
+  {
+    in_memory(row) = row * 2;
+    from_file(row) = row * 2;
+  }
+  for ( unsigned int column = 1; column < 3; ++column )
+  {
+    from_file.prefetch_column( column );
+    double expected_threshold = 0.0;
+    double threshold = 0.0;
+    double expected = in_memory.information_gain( 0, column, expected_threshold );
+    CPPUNIT_ASSERT_EQUAL( expected, from_file.information_gain( 0, column, threshold ) );
+    CPPUNIT_ASSERT_EQUAL( expected_threshold, threshold );
+  }
+  mapped.advise_column( 1, Dataset::SequentialAccess );
+  mapped.advise_column( 1, Dataset::NormalAccess );
+
+  // Binning scans the mapped columns to the same codes.
+  Dataset::BinnedMatrix expected_bins( matrix, 0, 16 );
+  Dataset::BinnedMatrix bins( mapped, 0, 16 );
+  for ( unsigned int column = 0; column < 3; ++column )
+  {
+    CPPUNIT_ASSERT_EQUAL( expected_bins.bin_count(column), bins.bin_count(column) );
+    for ( unsigned int row = 0; row < rows; row += 97 )
+    {
+      CPPUNIT_ASSERT_EQUAL( expected_bins.code(row, column), bins.code(row, column) );
+    }
+  }
+
+  remove( Filename );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,27 @@
+/*
+ * ut_ColumnFile.h
+ */
+
+#ifndef __ut_ColumnFile_h__
+#define __ut_ColumnFile_h__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestFixture.h>
+
+class ut_ColumnFile : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( ut_ColumnFile );
+    CPPUNIT_TEST( testMethod_write );
+    CPPUNIT_TEST( testMethod_convert );
+    CPPUNIT_TEST( testMethod_open_invalid );
+    CPPUNIT_TEST( testMethod_train_mapped );
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testMethod_write( void );
+    void testMethod_convert( void );
+    void testMethod_open_invalid( void );
+    void testMethod_train_mapped( void );
+};
+
+#endif
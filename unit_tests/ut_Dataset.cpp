@@ -15,34 +15,52 @@ using namespace std;
 
 //------------------------------------------------------------------------------
 
-void ut_Dataset::ProbabilityMap_testMethod_entropy( void )
+void ut_Dataset::ClassHistogram_testClass( void )
 {
-  // Check entropy calculation.
-  Dataset::ProbabilityMap pmap;
+  // Check entropy and gini calculation.
+  Dataset::ClassHistogram<4> histogram;
 
   // No entries.
-  CPPUNIT_ASSERT_DOUBLES_EQUAL(
-    0.0, pmap.entropy(), 1e-9 );
-
-  // One entry.
-  pmap["e1"] = 1.0;
-  CPPUNIT_ASSERT_DOUBLES_EQUAL(
-    0.0, pmap.entropy(), 1e-9 );
-
-  // A few entries, one with value zero.
-  pmap["e1"] = 0.5;
-  pmap["e2"] = 0.5;
-  pmap["e3"] = 0.0;
-  CPPUNIT_ASSERT_DOUBLES_EQUAL(
-    0.301029995663981, pmap.entropy(), 1e-9 );
+  CPPUNIT_ASSERT_EQUAL( 0u, histogram.total() );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.entropy(), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.gini(), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.probability(0), 1e-9 );
+
+  // One class.
+  histogram.add( 0 );
+  histogram.add( 0 );
+  CPPUNIT_ASSERT_EQUAL( 2u, histogram.total() );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.entropy(), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.gini(), 1e-9 );
+  CPPUNIT_ASSERT_EQUAL( 0u, histogram.majority() );
+
+  // Two classes evenly, one with count zero.
+  histogram.add( 1 );
+  histogram.add( 1 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, histogram.entropy(), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, histogram.gini(), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, histogram.probability(1), 1e-9 );
+  CPPUNIT_ASSERT_EQUAL( 0u, histogram.majority() );
 
   // A few more entries.
-  pmap["e1"] = 0.1;
-  pmap["e2"] = 0.2;
-  pmap["e3"] = 0.3;
-  pmap["e4"] = 0.4;
-  CPPUNIT_ASSERT_DOUBLES_EQUAL(
-    0.55583362792012, pmap.entropy(), 1e-9 );
+  histogram.clear();
+  for ( unsigned int c = 0; c < 4; ++c )
+  {
+    histogram[c] = c + 1;
+  }
+  CPPUNIT_ASSERT_EQUAL( 10u, histogram.total() );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.846439344671015, histogram.entropy(), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.7, histogram.gini(), 1e-9 );
+  CPPUNIT_ASSERT_EQUAL( 3u, histogram.majority() );
+
+  // Add and subtract.
+  Dataset::ClassHistogram<4> other;
+  other.add( 3 );
+  histogram.subtract( other );
+  CPPUNIT_ASSERT_EQUAL( 3u, histogram[3] );
+  histogram.add( other );
+  histogram.add( other );
+  CPPUNIT_ASSERT_EQUAL( 5u, histogram[3] );
 }
 
 //------------------------------------------------------------------------------
@@ -118,14 +136,223 @@ void ut_Dataset::RealMatrix_testClass( void )
           writeable[column] = index;
           CPPUNIT_ASSERT_EQUAL( index, writeable[column] );
           CPPUNIT_ASSERT_EQUAL( index, unwriteable[column] );
+          CPPUNIT_ASSERT_EQUAL( index, matrix.at(row, column) );
+        }
+      }
+
+      // Column-major matrices hold the same elements with contiguous columns.
+      Dataset::RealMatrix matrix_cm( rowSpan, columnSpan, Dataset::ColumnMajor );
+      CPPUNIT_ASSERT_EQUAL( Dataset::ColumnMajor, matrix_cm.get_layout() );
+      for ( unsigned int row = 0; row < matrix_cm.row_count(); ++row )
+      {
+        for ( unsigned int column = 0; column < matrix_cm.column_count(); ++column )
+        {
+          CPPUNIT_ASSERT_EQUAL( 0.0, matrix_cm.at(row, column) );
+          matrix_cm.at(row, column) = matrix.at(row, column);
         }
       }
+      double row_buffer[10];
+      for ( unsigned int row = 0; row < matrix_cm.row_count(); ++row )
+      {
+        matrix_cm.copy_row( row, row_buffer );
+        for ( unsigned int column = 0; column < matrix_cm.column_count(); ++column )
+        {
+          CPPUNIT_ASSERT_EQUAL( matrix[row][column], row_buffer[column] );
+          CPPUNIT_ASSERT_EQUAL(
+            matrix[row][column], matrix_cm.column_data(column)[row] );
+        }
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ut_Dataset::RealMatrix_testStorage( void )
+{
+  // Column 0 is the class, column 1 has 1000 distinct values, column 2 has
+  // 300 and column 3 holds a value floats can't represent.
+  const unsigned int rows = 1000;
+  Dataset ds( rows, 4 );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    ds[row][0] = row % 2;
+    ds[row][1] = rows - row;
+    ds[row][2] = row % 300;
+    ds[row][3] = 0.1 * (row % 3);
+  }
+
+  // Copy every other row, last first.
+  Dataset sample( ds, rows / 2 );
+  for ( unsigned int row = 0; row < sample.row_count(); ++row )
+  {
+    sample(row) = rows - 2 * row - 1;
+  }
+
+  // A double copy holds the rows as they are.
+  Dataset::RealMatrix doubles( sample, Dataset::DoubleStorage );
+  CPPUNIT_ASSERT_EQUAL( Dataset::ColumnMajor, doubles.get_layout() );
+  CPPUNIT_ASSERT_EQUAL( sample.row_count(), doubles.row_count() );
+  CPPUNIT_ASSERT_EQUAL( 4u, doubles.column_count() );
+  CPPUNIT_ASSERT_EQUAL( 500ul * 4 * sizeof(double), doubles.byte_size() );
+
+  // A float copy rounds them to single precision in half the memory.
+  Dataset::RealMatrix floats( sample, Dataset::FloatStorage );
+  CPPUNIT_ASSERT_EQUAL( Dataset::FloatStorage, floats.get_storage() );
+  CPPUNIT_ASSERT_EQUAL( 500ul * 4 * sizeof(float), floats.byte_size() );
+
+  // A coded copy keeps every value of a column with few enough of them.
+  Dataset::RealMatrix codes( sample, Dataset::CodeStorage );
+  CPPUNIT_ASSERT_EQUAL( Dataset::CodeStorage, codes.get_storage() );
+  CPPUNIT_ASSERT( codes.byte_size() < doubles.byte_size() );
+  double row_buffer[4];
+  for ( unsigned int row = 0; row < sample.row_count(); ++row )
+  {
+    for ( unsigned int column = 0; column < 4; ++column )
+    {
+      double value = sample.get( row, column );
+      CPPUNIT_ASSERT_EQUAL( value, doubles.at( row, column ) );
+      CPPUNIT_ASSERT_EQUAL( static_cast<double>(static_cast<float>(value)), floats.get( row, column ) );
+      CPPUNIT_ASSERT_EQUAL( value, codes.get( row, column ) );
+    }
+    codes.copy_row( row, row_buffer );
+    CPPUNIT_ASSERT_EQUAL( sample.get( row, 3 ), row_buffer[3] );
+  }
+  CPPUNIT_ASSERT( floats.get( 1, 3 ) != sample.get( 1, 3 ) );
+
+  // With fewer codes, a column is quantized: every element becomes the upper
+  // edge of its bin, so it keeps its side of every edge.
+  Dataset::RealMatrix coarse( sample, Dataset::CodeStorage, 10 );
+  for ( unsigned int row = 0; row < sample.row_count(); ++row )
+  {
+    double value = sample.get( row, 1 );
+    double coded = coarse.get( row, 1 );
+    CPPUNIT_ASSERT( value <= coded );
+    CPPUNIT_ASSERT( coded - value < 100.0 );
+    CPPUNIT_ASSERT_EQUAL( sample.get( row, 0 ), coarse.get( row, 0 ) );
+  }
+  CPPUNIT_ASSERT_EQUAL( 99.0, coarse.get( 0, 1 ) );
+  CPPUNIT_ASSERT_EQUAL( 999.0, coarse.get( 499, 1 ) );
+  CPPUNIT_ASSERT( coarse.byte_size() < codes.byte_size() );
+
+  // A dataset views a compact matrix like any other.
+  Dataset coded( codes, 2 );
+  coded(0) = 0;
+  coded(1) = 1;
+  const Dataset & coded_view = coded;
+  CPPUNIT_ASSERT_EQUAL( sample.get( 1, 2 ), coded.get( 1, 2 ) );
+  CPPUNIT_ASSERT_EQUAL( sample.get( 1, 3 ), coded_view.value( 1, 3 ) );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_Dataset::BinnedMatrix_testClass( void )
+{
+  // Column 0 is the class, column 1 has 100 distinct values and column 2
+  // has only two.
+  const unsigned int rows = 100;
+  Dataset::RealMatrix matrix( rows, 3 );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    matrix[row][0] = row % 2;
+    matrix[row][1] = rows - row;
+    matrix[row][2] = ( row < 30 ) ? 5.0 : -5.0;
+  }
+
+  Dataset::BinnedMatrix bins( matrix, 0, 10 );
+  CPPUNIT_ASSERT_EQUAL( 10u, bins.bin_count(1) );
+  CPPUNIT_ASSERT_EQUAL( 2u, bins.bin_count(2) );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( -5.0, bins.edge(2, 0), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 5.0, bins.edge(2, 1), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0, bins.edge(1, 9), 1e-9 );
+
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    CPPUNIT_ASSERT_EQUAL( (row % 2) == 1, bins.classification(row) );
+    for ( unsigned int column = 1; column < 3; ++column )
+    {
+      // Every value lies within its bin.
+      unsigned int code = bins.code( row, column );
+      CPPUNIT_ASSERT( code < bins.bin_count(column) );
+      CPPUNIT_ASSERT( matrix[row][column] <= bins.edge(column, code) );
+      if ( code > 0 )
+      {
+        CPPUNIT_ASSERT( matrix[row][column] > bins.edge(column, code - 1) );
+      }
+    }
+  }
+
+  // Binning a sample covers only its rows, repeats and all, and finds them
+  // by matrix row.
+  Dataset sample( matrix, 40 );
+  for ( unsigned int row = 0; row < sample.row_count(); ++row )
+  {
+    sample(row) = 99 - (row % 20) * 3;
+  }
+  Dataset::BinnedMatrix sample_bins( sample, 0, 10 );
+  CPPUNIT_ASSERT_EQUAL( 1u, sample_bins.bin_count(2) );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( -5.0, sample_bins.edge(2, 0), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 58.0, sample_bins.edge(1, 9), 1e-9 );
+  for ( unsigned int row = 0; row < sample.row_count(); ++row )
+  {
+    unsigned int matrix_row = sample(row);
+    CPPUNIT_ASSERT_EQUAL( (matrix_row % 2) == 1, sample_bins.classification(matrix_row) );
+    unsigned int code = sample_bins.code( matrix_row, 1 );
+    CPPUNIT_ASSERT( matrix[matrix_row][1] <= sample_bins.edge(1, code) );
+    if ( code > 0 )
+    {
+      CPPUNIT_ASSERT( matrix[matrix_row][1] > sample_bins.edge(1, code - 1) );
     }
   }
 }
 
 //------------------------------------------------------------------------------
 
+void ut_Dataset::BinnedMatrix_testMethod_merge_edges( void )
+{
+  // Two shards of a column: 0 to 99 and 100 to 199, binned into 10 each.
+  const unsigned int rows = 100;
+  Dataset::ThresholdVector candidates;
+  vector<double> weights;
+  for ( unsigned int shard = 0; shard < 2; ++shard )
+  {
+    Dataset::RealMatrix matrix( rows, 2 );
+    for ( unsigned int row = 0; row < rows; ++row )
+    {
+      matrix[row][0] = row % 2;
+      matrix[row][1] = shard * rows + row;
+    }
+    Dataset::BinnedMatrix bins( matrix, 0, 10 );
+    for ( unsigned int bin = 0; bin < bins.bin_count( 1 ); ++bin )
+    {
+      candidates.push_back( bins.edge( 1, bin ) );
+      weights.push_back( 10.0 );
+    }
+  }
+
+  // The merged edges cover both shards evenly.
+  Dataset::ThresholdVector edges;
+  Dataset::BinnedMatrix::merge_edges( candidates, weights, 10, edges );
+  CPPUNIT_ASSERT_EQUAL( 10u, static_cast<unsigned int>(edges.size()) );
+  for ( unsigned int bin = 0; bin < edges.size(); ++bin )
+  {
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 20.0 * bin + 19.0, edges[bin], 1e-9 );
+  }
+
+  // Few enough distinct candidates are all kept, repeats once.
+  Dataset::ThresholdVector few;
+  few.push_back( 3.0 );
+  few.push_back( 1.0 );
+  few.push_back( 3.0 );
+  vector<double> few_weights( 3, 1.0 );
+  Dataset::BinnedMatrix::merge_edges( few, few_weights, 10, edges );
+  CPPUNIT_ASSERT_EQUAL( 2u, static_cast<unsigned int>(edges.size()) );
+  CPPUNIT_ASSERT_EQUAL( 1.0, edges[0] );
+  CPPUNIT_ASSERT_EQUAL( 3.0, edges[1] );
+}
+
+//------------------------------------------------------------------------------
+
 void ut_Dataset::testConstructors( void )
 {
   const unsigned int rows = 10;
@@ -154,6 +381,17 @@ void ut_Dataset::testConstructors( void )
   CPPUNIT_ASSERT_EQUAL( rows, ds2.data->row_count() );
   CPPUNIT_ASSERT_EQUAL( cols, ds2.data->column_count() );
   CPPUNIT_ASSERT_EQUAL( ds1.data, ds2.data );
+
+  // Test range constructor. The range shares the reference indices.
+  Dataset ds3( ds1, 2, 7 );
+  CPPUNIT_ASSERT_EQUAL( true, ds3.usingRef );
+  CPPUNIT_ASSERT_EQUAL( 5u, ds3.row_count() );
+  CPPUNIT_ASSERT_EQUAL( &ds1(2), &ds3(0) );
+  for ( unsigned int r = 0; r < ds3.row_count(); ++r )
+  {
+    CPPUNIT_ASSERT_EQUAL( r + 2, ds3(r) );
+  }
+  CPPUNIT_ASSERT_EQUAL( ds1.data, ds3.data );
 }
 
 //------------------------------------------------------------------------------
@@ -193,7 +431,7 @@ void ut_Dataset::testMethod_enumerate_threshold( void )
   // Create dataset.
   const unsigned int rows = 10;
   const unsigned int cols = 1;
-  Dataset::ProbabilityMap pmap;
+  Dataset::ThresholdHistogram histogram;
   Dataset ds1( rows, cols );
 
   // Populate dataset.
@@ -203,15 +441,15 @@ void ut_Dataset::testMethod_enumerate_threshold( void )
   }
 
   // Enumerate.
-  pmap = ds1.enumerate_threshold( 0, 5 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, pmap["LE"], 1e-9 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, pmap["G"], 1e-9 );
-  pmap = ds1.enumerate_threshold( 0, 10 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, pmap["LE"], 1e-9 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, pmap["G"], 1e-9 );
-  pmap = ds1.enumerate_threshold( 0, 0 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, pmap["LE"], 1e-9 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, pmap["G"], 1e-9 );
+  histogram = ds1.enumerate_threshold( 0, 5 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, histogram.probability(Dataset::LessEqual), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, histogram.probability(Dataset::Greater), 1e-9 );
+  histogram = ds1.enumerate_threshold( 0, 10 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, histogram.probability(Dataset::LessEqual), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.probability(Dataset::Greater), 1e-9 );
+  histogram = ds1.enumerate_threshold( 0, 0 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.probability(Dataset::LessEqual), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, histogram.probability(Dataset::Greater), 1e-9 );
 
   // New dataset.
   Dataset ds2( ds1, rows );
@@ -220,18 +458,18 @@ void ut_Dataset::testMethod_enumerate_threshold( void )
   // value of the first data element (which is 1).
 
   // Enumerate.
-  pmap = ds2.enumerate_threshold( 0, 5 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, pmap["LE"], 1e-9 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, pmap["G"], 1e-9 );
-  pmap = ds2.enumerate_threshold( 0, 10 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, pmap["LE"], 1e-9 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, pmap["G"], 1e-9 );
-  pmap = ds2.enumerate_threshold( 0, 1 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, pmap["LE"], 1e-9 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, pmap["G"], 1e-9 );
-  pmap = ds2.enumerate_threshold( 0, 0 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, pmap["LE"], 1e-9 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, pmap["G"], 1e-9 );
+  histogram = ds2.enumerate_threshold( 0, 5 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, histogram.probability(Dataset::LessEqual), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.probability(Dataset::Greater), 1e-9 );
+  histogram = ds2.enumerate_threshold( 0, 10 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, histogram.probability(Dataset::LessEqual), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.probability(Dataset::Greater), 1e-9 );
+  histogram = ds2.enumerate_threshold( 0, 1 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, histogram.probability(Dataset::LessEqual), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.probability(Dataset::Greater), 1e-9 );
+  histogram = ds2.enumerate_threshold( 0, 0 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.probability(Dataset::LessEqual), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, histogram.probability(Dataset::Greater), 1e-9 );
 
   // Map elements.
   for ( unsigned int row = 0; row < rows; ++row )
@@ -240,15 +478,15 @@ void ut_Dataset::testMethod_enumerate_threshold( void )
   }
 
   // Enumerate.
-  pmap = ds2.enumerate_threshold( 0, 5 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, pmap["LE"], 1e-9 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, pmap["G"], 1e-9 );
-  pmap = ds2.enumerate_threshold( 0, 10 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, pmap["LE"], 1e-9 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, pmap["G"], 1e-9 );
-  pmap = ds2.enumerate_threshold( 0, 0 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, pmap["LE"], 1e-9 );
-  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, pmap["G"], 1e-9 );
+  histogram = ds2.enumerate_threshold( 0, 5 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, histogram.probability(Dataset::LessEqual), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, histogram.probability(Dataset::Greater), 1e-9 );
+  histogram = ds2.enumerate_threshold( 0, 10 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, histogram.probability(Dataset::LessEqual), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.probability(Dataset::Greater), 1e-9 );
+  histogram = ds2.enumerate_threshold( 0, 0 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, histogram.probability(Dataset::LessEqual), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, histogram.probability(Dataset::Greater), 1e-9 );
 }
 
 //------------------------------------------------------------------------------
@@ -306,6 +544,49 @@ void ut_Dataset::testMethod_split( void )
 
 //------------------------------------------------------------------------------
 
+void ut_Dataset::testMethod_partition( void )
+{
+  // Create dataset with interleaved values.
+  const unsigned int rows = 10;
+  const unsigned int cols = 1;
+  Dataset ds( rows, cols );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    ds[row][0] = ( row % 2 ) ? row : rows + row;
+  }
+
+  // Partition.
+  unsigned int split_row = ds.partition( 0, 9.0 );
+  CPPUNIT_ASSERT_EQUAL( 5u, split_row );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    CPPUNIT_ASSERT_EQUAL( row < split_row, ds[row][0] <= 9.0 );
+  }
+
+  // Every row is still referenced exactly once.
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    CPPUNIT_ASSERT( ds.data_reference().contains(row) );
+  }
+
+  // Partitioning a range only reorders that range.
+  Dataset ds_g( ds, split_row, rows );
+  CPPUNIT_ASSERT_EQUAL( 2u, ds_g.partition( 0, 13.0 ) );
+  CPPUNIT_ASSERT( ds[5][0] <= 13.0 );
+  CPPUNIT_ASSERT( ds[6][0] <= 13.0 );
+  CPPUNIT_ASSERT( ds[7][0] > 13.0 );
+  for ( unsigned int row = 0; row < split_row; ++row )
+  {
+    CPPUNIT_ASSERT( ds[row][0] <= 9.0 );
+  }
+
+  // Degenerate splits.
+  CPPUNIT_ASSERT_EQUAL( 0u, ds.partition( 0, -1.0 ) );
+  CPPUNIT_ASSERT_EQUAL( rows, ds.partition( 0, 100.0 ) );
+}
+
+//------------------------------------------------------------------------------
+
 void ut_Dataset::testMethod_information_gain( void )
 {
   // Generate example dataset.
@@ -336,6 +617,116 @@ void ut_Dataset::testMethod_information_gain( void )
     CPPUNIT_ASSERT_DOUBLES_EQUAL(
       class_threshold, threshold, 1e-9 );
   }
+
+  // Column-major data gives the same result.
+  Dataset ds_cm( rows, cols, Dataset::ColumnMajor );
+  for ( unsigned int row = 0; row < ds_cm.row_count(); ++row )
+  {
+    ds_cm.value(row, 0) = row + 1;
+    ds_cm.value(row, 1) = ( row < 3 ) ? 1.0 : 0.0;
+  }
+  double threshold_cm = 0.0;
+  double ig_cm = ds_cm.information_gain( 1, 0, threshold_cm );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 3.0, threshold_cm, 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.881290899230693, ig_cm, 1e-9 );
+
+  // Repeated attribute values must stay on the same side of the split.
+  Dataset ds_repeated( 6, cols );
+  for ( unsigned int row = 0; row < ds_repeated.row_count(); ++row )
+  {
+    ds_repeated[row][0] = 3.0 - row / 2;
+    ds_repeated[row][1] = ( row < 2 ) ? 1.0 : 0.0;
+  }
+  double threshold = 0.0;
+  double ig = ds_repeated.information_gain( 1, 0, threshold );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.0, threshold, 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.918295834054490, ig, 1e-9 );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_Dataset::testMethod_information_gain_binned( void )
+{
+  // Generate example dataset.
+  const unsigned int rows       = 10;
+  const unsigned int cols       = 2;
+  Dataset ds( rows, cols );
+
+  for ( double class_threshold = 1.0; class_threshold < 10.0; class_threshold += 1.0 )
+  {
+    for ( unsigned int row = 0; row < ds.row_count(); ++row )
+    {
+      ds[row][0] = row + 1;
+      ds[row][1] = ( ds[row][0] > class_threshold ) ? 1.0 : 0.0;
+    }
+
+    // With a bin per value, histogram splits match exact splits.
+    Dataset::BinnedMatrix exact_bins( ds.data_matrix(), 1, rows );
+    ds.set_bins( &exact_bins );
+    double threshold = 0.0;
+    double exact_threshold = 0.0;
+    double ig = ds.information_gain_binned( 0, threshold );
+    double exact_ig = ds.information_gain( 1, 0, exact_threshold );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( exact_threshold, threshold, 1e-9 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( exact_ig, ig, 1e-9 );
+
+    // With fewer bins, the threshold is the bin edge next to the class
+    // boundary (edges are 2, 4, ..., 10).
+    Dataset::BinnedMatrix coarse_bins( ds.data_matrix(), 1, 5 );
+    ds.set_bins( &coarse_bins );
+    ds.information_gain_binned( 0, threshold );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, fmod(threshold, 2.0), 1e-9 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( class_threshold, threshold, 1.0 );
+    ds.set_bins( null(Dataset::BinnedMatrix) );
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ut_Dataset::testMethod_information_gain_storage( void )
+{
+  // Generate example dataset.
+  const unsigned int rows       = 10;
+  const unsigned int cols       = 2;
+  Dataset ds( rows, cols );
+
+  for ( double class_threshold = 1.0; class_threshold < 10.0; class_threshold += 1.0 )
+  {
+    for ( unsigned int row = 0; row < ds.row_count(); ++row )
+    {
+      ds[row][0] = ( row + 1 ) * 0.1;
+      ds[row][1] = ( row + 1 > class_threshold ) ? 1.0 : 0.0;
+    }
+    double exact_threshold = 0.0;
+    double exact_ig = ds.information_gain( 1, 0, exact_threshold );
+
+    // Split search on a coded copy finds the same split, and on a float copy
+    // the same split up to float rounding.
+    Dataset::RealMatrix codes( ds, Dataset::CodeStorage );
+    Dataset::RealMatrix floats( ds, Dataset::FloatStorage );
+    Dataset ds_codes( codes, rows );
+    Dataset ds_floats( floats, rows );
+    for ( unsigned int row = 0; row < rows; ++row )
+    {
+      ds_codes(row) = row;
+      ds_floats(row) = row;
+    }
+    double threshold = 0.0;
+    double ig = ds_codes.information_gain( 1, 0, threshold );
+    CPPUNIT_ASSERT_EQUAL( exact_threshold, threshold );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( exact_ig, ig, 1e-9 );
+    ig = ds_floats.information_gain( 1, 0, threshold );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( exact_threshold, threshold, 1e-6 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( exact_ig, ig, 1e-9 );
+
+    // Partitioning on it separates the classes.
+    unsigned int le_rows = ds_codes.partition( 0, exact_threshold );
+    CPPUNIT_ASSERT_EQUAL( static_cast<unsigned int>(class_threshold), le_rows );
+    for ( unsigned int row = 0; row < rows; ++row )
+    {
+      CPPUNIT_ASSERT_EQUAL( ( row < le_rows ) ? 0.0 : 1.0, ds_codes.get( row, 1 ) );
+    }
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -354,15 +745,37 @@ void ut_Dataset::testMethod_bootstrap_sample( void )
   }
 
   // Create a bootstrap sample.
+  RandomStream random( 1 );
   for ( unsigned int sample_size = 0; sample_size < 20; ++sample_size )
   {
-    Dataset sample = ds.bootstrap_sample(sample_size);
+    Dataset sample = ds.bootstrap_sample(sample_size, random);
     CPPUNIT_ASSERT_EQUAL( sample_size, sample.row_count() );
     for ( unsigned int row = 0; row < sample_size; ++row )
     {
       CPPUNIT_ASSERT( (sample(row) >= 0) && (sample(row) < ds.row_count()) );
     }
   }
+
+  // The same stream gives the same sample.
+  RandomStream random_a( 7, 1, 2 );
+  RandomStream random_b( 7, 1, 2 );
+  Dataset sample_a = ds.bootstrap_sample(20, random_a);
+  Dataset sample_b = ds.bootstrap_sample(20, random_b);
+  for ( unsigned int row = 0; row < 20; ++row )
+  {
+    CPPUNIT_ASSERT_EQUAL( sample_a(row), sample_b(row) );
+  }
+
+  // A sample of a view only contains rows of the view.
+  Dataset view( ds, 3 );
+  view(0) = 2;
+  view(1) = 5;
+  view(2) = 7;
+  Dataset view_sample = view.bootstrap_sample(20, random);
+  for ( unsigned int row = 0; row < 20; ++row )
+  {
+    CPPUNIT_ASSERT( (view_sample(row) == 2) || (view_sample(row) == 5) || (view_sample(row) == 7) );
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -14,14 +14,19 @@
 class ut_Dataset : public CppUnit::TestFixture
 {
   CPPUNIT_TEST_SUITE( ut_Dataset );
-    // For ProbabilityMap subclass.
-    CPPUNIT_TEST( ProbabilityMap_testMethod_entropy );
+    // For ClassHistogram subclass.
+    CPPUNIT_TEST( ClassHistogram_testClass );
 
     // For IntegerColumn subclass.
     CPPUNIT_TEST( IntegerColumn_testClass );
 
     // For RealMatrix subclass.
     CPPUNIT_TEST( RealMatrix_testClass );
+    CPPUNIT_TEST( RealMatrix_testStorage );
+
+    // For BinnedMatrix subclass.
+    CPPUNIT_TEST( BinnedMatrix_testClass );
+    CPPUNIT_TEST( BinnedMatrix_testMethod_merge_edges );
 
     // For Dataset main class.
     CPPUNIT_TEST( testConstructors );
@@ -29,20 +34,28 @@ class ut_Dataset : public CppUnit::TestFixture
     CPPUNIT_TEST( testMethod_enumerate_threshold );
     CPPUNIT_TEST( testMethod_get_thresholds );
     CPPUNIT_TEST( testMethod_split );
+    CPPUNIT_TEST( testMethod_partition );
     CPPUNIT_TEST( testMethod_information_gain );
+    CPPUNIT_TEST( testMethod_information_gain_binned );
+    CPPUNIT_TEST( testMethod_information_gain_storage );
     CPPUNIT_TEST( testMethod_bootstrap_sample );
     CPPUNIT_TEST( testMethod_out_of_bag_set );
   CPPUNIT_TEST_SUITE_END();
 
   public:
-    // For ProbabilityMap subclass.
-    void ProbabilityMap_testMethod_entropy( void );
+    // For ClassHistogram subclass.
+    void ClassHistogram_testClass( void );
 
     // For IntegerColumn subclass.
     void IntegerColumn_testClass( void );
 
     // For RealMatrix subclass.
     void RealMatrix_testClass( void );
+    void RealMatrix_testStorage( void );
+
+    // For BinnedMatrix subclass.
+    void BinnedMatrix_testClass( void );
+    void BinnedMatrix_testMethod_merge_edges( void );
 
     // For Dataset main class.
     void testConstructors( void );
@@ -50,7 +63,10 @@ class ut_Dataset : public CppUnit::TestFixture
     void testMethod_enumerate_threshold( void );
     void testMethod_get_thresholds( void );
     void testMethod_split( void );
+    void testMethod_partition( void );
     void testMethod_information_gain( void );
+    void testMethod_information_gain_binned( void );
+    void testMethod_information_gain_storage( void );
     void testMethod_bootstrap_sample( void );
     void testMethod_out_of_bag_set( void );
 };
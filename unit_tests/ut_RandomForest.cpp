@@ -13,7 +13,9 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 using namespace std;
 
@@ -153,9 +155,11 @@ void ut_RandomForest::testMethod_grow_forest( void )
   // Data should be loaded. Time to grow the forest.
   cout << "Grow..." << endl;
   RandomForest forest;
+  forest.set_thread_count( 3 );
   forest.grow_forest(
     *ds, 0, ds->row_count() / 3, split_keys, 16, 100 );
   cout << "Grown!" << endl;
+  CPPUNIT_ASSERT_EQUAL( 100u, forest.get_size() );
 
   // Classify the data.
   unsigned int tp = 0;
@@ -186,9 +190,212 @@ void ut_RandomForest::testMethod_grow_forest( void )
 
 //------------------------------------------------------------------------------
 
+void ut_RandomForest::testMethod_grow_forest_deterministic( void )
+{
+  Dataset::KeyList split_keys = ds->get_keys();
+  split_keys.erase("class");
+
+  // Grow the same forest with different thread counts.
+  RandomForest forest_1;
+  forest_1.set_seed( 42, 3 );
+  forest_1.set_thread_count( 1 );
+  forest_1.grow_forest( *ds, 0, ds->row_count() / 3, split_keys, 16, 10 );
+
+  RandomForest forest_4;
+  forest_4.set_seed( 42, 3 );
+  forest_4.set_thread_count( 4 );
+  forest_4.grow_forest( *ds, 0, ds->row_count() / 3, split_keys, 16, 10 );
+
+  // Trees must be identical and in the same order.
+  CPPUNIT_ASSERT_EQUAL( 10u, forest_1.get_size() );
+  CPPUNIT_ASSERT_EQUAL( 10u, forest_4.get_size() );
+  for ( unsigned int tree = 0; tree < forest_1.get_size(); ++tree )
+  {
+    CPPUNIT_ASSERT_EQUAL(
+      forest_1.forest[tree]->draw(), forest_4.forest[tree]->draw() );
+  }
+
+  // A different stream grows a different forest.
+  RandomForest forest_other;
+  forest_other.set_seed( 42, 4 );
+  forest_other.grow_forest( *ds, 0, ds->row_count() / 3, split_keys, 16, 1 );
+  CPPUNIT_ASSERT( forest_1.forest[0]->draw() != forest_other.forest[0]->draw() );
+
+  // Growing part of the forest from a later tree gives the same trees.
+  RandomForest forest_part;
+  forest_part.set_seed( 42, 3 );
+  forest_part.grow_forest( *ds, 0, ds->row_count() / 3, split_keys, 16, 3, 6 );
+  CPPUNIT_ASSERT_EQUAL( 3u, forest_part.get_size() );
+  for ( unsigned int tree = 0; tree < forest_part.get_size(); ++tree )
+  {
+    CPPUNIT_ASSERT_EQUAL(
+      forest_1.forest[tree + 6]->draw(), forest_part.forest[tree]->draw() );
+  }
+
+  // Merging moves the trees to the end of the other forest.
+  forest_other.merge( forest_part );
+  CPPUNIT_ASSERT_EQUAL( 0u, forest_part.get_size() );
+  CPPUNIT_ASSERT_EQUAL( 4u, forest_other.get_size() );
+  CPPUNIT_ASSERT_EQUAL( forest_1.forest[6]->draw(), forest_other.forest[1]->draw() );
+}
+
+//------------------------------------------------------------------------------
+
 void ut_RandomForest::testMethod_classify( void )
 {
-  //
+  Dataset::KeyList split_keys = ds->get_keys();
+  split_keys.erase("class");
+
+  // Grow a small forest.
+  RandomForest forest;
+  forest.grow_forest( *ds, 0, ds->row_count() / 3, split_keys, 16, 9 );
+
+  // Batch classification matches row-by-row classification.
+  unsigned int rows = ds->row_count();
+  bool * classifications = new bool[rows];
+  forest.classify_batch( *ds, classifications );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    CPPUNIT_ASSERT_EQUAL( forest.classify((*ds)[row]), classifications[row] );
+  }
+
+  // Also on column-major data, in reverse row order.
+  unsigned int columns = ds->data_matrix().column_count();
+  Dataset ds_cm( rows, columns, Dataset::ColumnMajor );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    for ( unsigned int column = 0; column < columns; ++column )
+    {
+      ds_cm.value(row, column) = (*ds)[row][column];
+    }
+    ds_cm(row) = rows - row - 1;
+  }
+  bool * classifications_cm = new bool[rows];
+  forest.classify_batch( ds_cm, classifications_cm );
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    CPPUNIT_ASSERT_EQUAL( classifications[rows - row - 1], classifications_cm[row] );
+  }
+
+  delete [] classifications;
+  delete [] classifications_cm;
+}
+
+//------------------------------------------------------------------------------
+
+void ut_RandomForest::testMethod_classify_batch_threaded( void )
+{
+  Dataset::KeyList split_keys = ds->get_keys();
+  split_keys.erase("class");
+
+  // Enough trees that a batch of a few thousand rows goes parallel.
+  RandomForest forest;
+  forest.set_thread_count( 4 );
+  forest.grow_forest( *ds, 0, ds->row_count() / 10, split_keys, 16, 80 );
+  unsigned int rows = ds->row_count();
+
+  // A large batch splits into row blocks; repeat the rows to build one.
+  unsigned int large_rows = 4 * RandomForest::ParallelBatchVotes / 80;
+  CPPUNIT_ASSERT( large_rows > 4 * RandomForest::BatchBlockRows );
+  Dataset large( *ds, large_rows );
+  for ( unsigned int row = 0; row < large_rows; ++row )
+  {
+    large(row) = row % rows;
+  }
+  bool * classifications = new bool[large_rows];
+  forest.classify_batch( large, classifications );
+  for ( unsigned int row = 0; row < large_rows; ++row )
+  {
+    CPPUNIT_ASSERT_EQUAL( forest.classify(large[row]), classifications[row] );
+  }
+
+  // A batch of fewer blocks than threads splits the trees.
+  unsigned int small_rows = RandomForest::ParallelBatchVotes / 80 + 1;
+  CPPUNIT_ASSERT( small_rows < 4 * RandomForest::BatchBlockRows );
+  Dataset small( large, 0, small_rows );
+  forest.classify_batch( small, classifications );
+  for ( unsigned int row = 0; row < small_rows; ++row )
+  {
+    CPPUNIT_ASSERT_EQUAL( forest.classify(small[row]), classifications[row] );
+  }
+
+  delete [] classifications;
+}
+
+//------------------------------------------------------------------------------
+
+void ut_RandomForest::testMethod_model( void )
+{
+  Dataset::KeyList split_keys = ds->get_keys();
+  split_keys.erase("class");
+
+  // Grow a small forest and write it out.
+  RandomForest forest;
+  forest.grow_forest( *ds, 0, ds->row_count() / 3, split_keys, 16, 9 );
+  const char * filename = "data/output/model_test.bin";
+  ofstream stream( filename, ios_base::out | ios_base::binary );
+  forest.write_model( stream, &ds->get_keys() );
+  stream.close();
+
+  // The mapped model classifies like the grown forest.
+  RandomForest mapped;
+  CPPUNIT_ASSERT( mapped.map_model(filename) );
+  CPPUNIT_ASSERT_EQUAL( forest.get_size(), mapped.get_size() );
+  for ( unsigned int row = 0; row < ds->row_count(); ++row )
+  {
+    CPPUNIT_ASSERT_EQUAL( forest.classify((*ds)[row]), mapped.classify((*ds)[row]) );
+  }
+  Dataset::KeyList keys;
+  CPPUNIT_ASSERT( mapped.read_model_keys(keys) );
+  CPPUNIT_ASSERT( keys == ds->get_keys() );
+
+  // The mapped trees serialize, and read back as the same forest.
+  stringstream serialized;
+  mapped.serialize( serialized );
+  RandomForest copy;
+  copy.deserialize( serialized );
+  CPPUNIT_ASSERT_EQUAL( forest.get_size(), copy.get_size() );
+  for ( unsigned int row = 0; row < ds->row_count(); ++row )
+  {
+    CPPUNIT_ASSERT_EQUAL( forest.classify((*ds)[row]), copy.classify((*ds)[row]) );
+  }
+  mapped.burn();
+  CPPUNIT_ASSERT_EQUAL( 0u, mapped.get_size() );
+  remove( filename );
+
+  // Load from memory, without a string table.
+  stringstream model;
+  forest.write_model( model );
+  string bytes = model.str();
+  vector<uint64_t> buffer( (bytes.size() + 7) / 8 );
+  memcpy( &buffer[0], bytes.data(), bytes.size() );
+  RandomForest loaded;
+  CPPUNIT_ASSERT( loaded.load_model(&buffer[0], bytes.size()) );
+  CPPUNIT_ASSERT_EQUAL( forest.get_size(), loaded.get_size() );
+  CPPUNIT_ASSERT( !loaded.read_model_keys(keys) );
+  CPPUNIT_ASSERT_EQUAL( forest.classify((*ds)[0]), loaded.classify((*ds)[0]) );
+  CPPUNIT_ASSERT( loaded.get_model_column_count() > 0 );
+  CPPUNIT_ASSERT( loaded.get_model_column_count() <= ds->data_matrix().column_count() );
+
+  // Truncated and corrupt models are rejected.
+  CPPUNIT_ASSERT( !loaded.load_model(&buffer[0], bytes.size() - 1) );
+  CPPUNIT_ASSERT_EQUAL( 0u, loaded.get_size() );
+  ModelFile::Header header;
+  memcpy( &header, &buffer[0], sizeof(header) );
+  RandomTree::CompiledNode * nodes =
+    reinterpret_cast<RandomTree::CompiledNode*>(
+      reinterpret_cast<char*>(&buffer[0]) + header.node_offset );
+  CPPUNIT_ASSERT( nodes[0].column != RandomTree::LeafColumn );
+  unsigned int column = nodes[0].column;
+  nodes[0].column = header.column_count;
+  CPPUNIT_ASSERT( !loaded.load_model(&buffer[0], bytes.size()) );
+  nodes[0].column = column;
+  CPPUNIT_ASSERT( loaded.load_model(&buffer[0], bytes.size()) );
+  nodes[0].child = 0;
+  CPPUNIT_ASSERT( !loaded.load_model(&buffer[0], bytes.size()) );
+  header.byte_order = 0x04030201u;
+  memcpy( &buffer[0], &header, sizeof(header) );
+  CPPUNIT_ASSERT( !loaded.load_model(&buffer[0], bytes.size()) );
 }
 
 //------------------------------------------------------------------------------
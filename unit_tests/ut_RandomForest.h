@@ -17,7 +17,10 @@ class ut_RandomForest : public CppUnit::TestFixture
 {
   CPPUNIT_TEST_SUITE( ut_RandomForest );
     CPPUNIT_TEST( testMethod_grow_forest );
+    CPPUNIT_TEST( testMethod_grow_forest_deterministic );
     CPPUNIT_TEST( testMethod_classify );
+    CPPUNIT_TEST( testMethod_classify_batch_threaded );
+    CPPUNIT_TEST( testMethod_model );
     CPPUNIT_TEST( testMethod_classify_oob_set );
   CPPUNIT_TEST_SUITE_END();
 
@@ -31,7 +34,10 @@ class ut_RandomForest : public CppUnit::TestFixture
     void tearDown( void );
 
     void testMethod_grow_forest( void );
+    void testMethod_grow_forest_deterministic( void );
     void testMethod_classify( void );
+    void testMethod_classify_batch_threaded( void );
+    void testMethod_model( void );
     void testMethod_classify_oob_set( void );
 
   private:
@@ -0,0 +1,84 @@
+/*
+ * ut_RandomStream.cpp
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "ut_RandomStream.h"
+#include "RandomStream.h"
+
+#include <vector>
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ut_RandomStream );
+
+//------------------------------------------------------------------------------
+
+void ut_RandomStream::testConstructor( void )
+{
+  // Same inputs give the same sequence.
+  RandomStream a( 1, 2, 3 );
+  RandomStream b( 1, 2, 3 );
+  for ( unsigned int i = 0; i < 100; ++i )
+  {
+    CPPUNIT_ASSERT( a.next() == b.next() );
+  }
+
+  // Changing any input gives a different sequence.
+  RandomStream seed( 2, 2, 3 );
+  RandomStream stream( 1, 3, 3 );
+  RandomStream index( 1, 2, 4 );
+  uint64_t value = a.next();
+  CPPUNIT_ASSERT( value != seed.next() );
+  CPPUNIT_ASSERT( value != stream.next() );
+  CPPUNIT_ASSERT( value != index.next() );
+
+  // Swapping stream and index gives a different sequence too.
+  RandomStream swapped( 1, 3, 2 );
+  RandomStream unswapped( 1, 2, 3 );
+  CPPUNIT_ASSERT( swapped.next() != unswapped.next() );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_RandomStream::testMethod_uniform( void )
+{
+  RandomStream random( 5 );
+  const unsigned int bound = 10;
+  const unsigned int draws = 100000;
+  vector<unsigned int> counts( bound, 0 );
+  for ( unsigned int i = 0; i < draws; ++i )
+  {
+    unsigned int value = random.uniform( bound );
+    CPPUNIT_ASSERT( value < bound );
+    ++counts[value];
+  }
+
+  // Roughly uniform.
+  for ( unsigned int value = 0; value < bound; ++value )
+  {
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(
+      draws / static_cast<double>(bound), counts[value], draws * 0.01 );
+  }
+
+  // A bound of one always gives zero.
+  CPPUNIT_ASSERT_EQUAL( 0u, random.uniform( 1 ) );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_RandomStream::testMethod_uniform_real( void )
+{
+  RandomStream random( 9 );
+  double sum = 0.0;
+  const unsigned int draws = 100000;
+  for ( unsigned int i = 0; i < draws; ++i )
+  {
+    double value = random.uniform_real();
+    CPPUNIT_ASSERT( (value >= 0.0) && (value < 1.0) );
+    sum += value;
+  }
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, sum / draws, 0.01 );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,25 @@
+/*
+ * ut_RandomStream.h
+ */
+
+#ifndef __ut_RandomStream_h__
+#define __ut_RandomStream_h__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestFixture.h>
+
+class ut_RandomStream : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( ut_RandomStream );
+    CPPUNIT_TEST( testConstructor );
+    CPPUNIT_TEST( testMethod_uniform );
+    CPPUNIT_TEST( testMethod_uniform_real );
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testConstructor( void );
+    void testMethod_uniform( void );
+    void testMethod_uniform_real( void );
+};
+
+#endif
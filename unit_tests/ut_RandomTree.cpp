@@ -12,6 +12,7 @@
 
 #include <string>
 #include <stdlib.h>
+#include <pthread.h>
 
 using namespace std;
 
@@ -68,6 +69,83 @@ namespace ut_RandomTree_ns
     }
     return tokens;
   }
+
+  // Stands in for a group of processes with threads that meet at a barrier.
+  struct ReducerGroup
+  {
+    pthread_barrier_t barrier;
+    pthread_mutex_t mutex;
+    vector<unsigned int> totals;
+    vector< vector<double> > parts;
+  };
+
+  class ThreadReducer : public HistogramReducer
+  {
+    public:
+      ThreadReducer( ReducerGroup & group, const unsigned int id ) :
+        group(group),
+        id(id)
+      {
+        //
+      }
+
+      virtual void sum( vector<unsigned int> & counts )
+      {
+        if ( id == 0 )
+        {
+          group.totals.assign( counts.size(), 0 );
+        }
+        pthread_barrier_wait( &group.barrier );
+        pthread_mutex_lock( &group.mutex );
+        for ( unsigned int i = 0; i < counts.size(); ++i )
+        {
+          group.totals[i] += counts[i];
+        }
+        pthread_mutex_unlock( &group.mutex );
+        pthread_barrier_wait( &group.barrier );
+        counts = group.totals;
+        pthread_barrier_wait( &group.barrier );
+      }
+
+      virtual void gather( vector<double> & values )
+      {
+        pthread_mutex_lock( &group.mutex );
+        if ( group.parts.size() <= id )
+        {
+          group.parts.resize( id + 1 );
+        }
+        group.parts[id] = values;
+        pthread_mutex_unlock( &group.mutex );
+        pthread_barrier_wait( &group.barrier );
+        values.clear();
+        for ( unsigned int part = 0; part < group.parts.size(); ++part )
+        {
+          values.insert( values.end(), group.parts[part].begin(), group.parts[part].end() );
+        }
+        pthread_barrier_wait( &group.barrier );
+      }
+
+    private:
+      ReducerGroup & group;
+      const unsigned int id;
+  };
+
+  struct ShardGrower
+  {
+    Dataset * shard;
+    const Dataset::KeyList * split_keys;
+    ThreadReducer * reducer;
+    RandomTree tree;
+  };
+
+  void * grow_shard( void * grower_pointer )
+  {
+    ShardGrower * grower = reinterpret_cast<ShardGrower*>(grower_pointer);
+    RandomStream random( 3 );
+    grower->tree.grow_decision_tree_distributed(
+      *grower->shard, *grower->split_keys, 2u, 0u, random, *grower->reducer );
+    return reinterpret_cast<void*>(0);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -168,7 +246,8 @@ void ut_RandomTree::testMethod_grow_decision_tree( void )
   split_keys["B"] = 2;
   split_keys["C"] = 3;
   RandomTree tree;
-  tree.grow_decision_tree( ds, split_keys, 2u, 0u );
+  RandomStream random( 0 );
+  tree.grow_decision_tree( ds, split_keys, 2u, 0u, random );
 
   // Draw tree.
   //cout << "Draw tree:" << endl;
@@ -177,6 +256,78 @@ void ut_RandomTree::testMethod_grow_decision_tree( void )
 
 //------------------------------------------------------------------------------
 
+void ut_RandomTree::testMethod_grow_decision_tree_distributed( void )
+{
+  using namespace ut_RandomTree_ns;
+
+  // Noisy data the tree can't separate in one split.
+  Dataset ds( 60, 4 );
+  RandomStream data_random( 11 );
+  for ( unsigned int row = 0; row < ds.row_count(); ++row )
+  {
+    ds[row][1] = data_random.uniform( 10 );
+    ds[row][2] = data_random.uniform( 25 ) / 4.0;
+    ds[row][3] = data_random.uniform( 3 );
+    ds[row][0] = ( (ds[row][1] + ds[row][3] > 6) != (data_random.uniform( 5 ) == 0) ) ? 1 : 0;
+  }
+  Dataset::BinnedMatrix bins( ds.data_matrix(), 0u, 8u );
+  ds.set_bins( &bins );
+
+  Dataset::KeyList split_keys;
+  split_keys["A"] = 1;
+  split_keys["B"] = 2;
+  split_keys["C"] = 3;
+
+  // Grown in one piece.
+  RandomTree reference;
+  RandomStream random( 3 );
+  reference.grow_decision_tree( ds, split_keys, 2u, 0u, random );
+  CPPUNIT_ASSERT( reference.get_compiled_node_count() > 3u );
+
+  // Grown from two unequal shards in step.
+  ReducerGroup group;
+  pthread_barrier_init( &group.barrier, NULL, 2 );
+  pthread_mutex_init( &group.mutex, NULL );
+  Dataset shard_a( ds, 0, 23 );
+  Dataset shard_b( ds, 23, ds.row_count() );
+  ThreadReducer reducer_a( group, 0 );
+  ThreadReducer reducer_b( group, 1 );
+  ShardGrower growers[2];
+  growers[0].shard = &shard_a;
+  growers[0].reducer = &reducer_a;
+  growers[1].shard = &shard_b;
+  growers[1].reducer = &reducer_b;
+  pthread_t threads[2];
+  for ( unsigned int g = 0; g < 2; ++g )
+  {
+    growers[g].split_keys = &split_keys;
+    pthread_create( &threads[g], NULL, grow_shard, &growers[g] );
+  }
+  for ( unsigned int g = 0; g < 2; ++g )
+  {
+    pthread_join( threads[g], NULL );
+  }
+  pthread_barrier_destroy( &group.barrier );
+  pthread_mutex_destroy( &group.mutex );
+
+  // Both shards grow the reference tree.
+  const RandomTree::CompiledNode * expected = reference.get_compiled_nodes();
+  for ( unsigned int g = 0; g < 2; ++g )
+  {
+    const RandomTree & tree = growers[g].tree;
+    CPPUNIT_ASSERT_EQUAL( reference.get_compiled_node_count(), tree.get_compiled_node_count() );
+    for ( unsigned int n = 0; n < tree.get_compiled_node_count(); ++n )
+    {
+      CPPUNIT_ASSERT_EQUAL( expected[n].column, tree.get_compiled_nodes()[n].column );
+      CPPUNIT_ASSERT_EQUAL( expected[n].child, tree.get_compiled_nodes()[n].child );
+      CPPUNIT_ASSERT_DOUBLES_EQUAL( expected[n].threshold, tree.get_compiled_nodes()[n].threshold, 1e-12 );
+    }
+  }
+  ds.set_bins( null(Dataset::BinnedMatrix) );
+}
+
+//------------------------------------------------------------------------------
+
 void ut_RandomTree::testMethod_classify( void )
 {
   // Build some sample dataset.
@@ -210,7 +361,8 @@ void ut_RandomTree::testMethod_classify( void )
   split_keys["B"] = 2;
   split_keys["C"] = 3;
   RandomTree tree;
-  tree.grow_decision_tree( ds, split_keys, 2u, 0u );
+  RandomStream random( 0 );
+  tree.grow_decision_tree( ds, split_keys, 2u, 0u, random );
 
   // Classify data. All should pass.
   for ( unsigned int row = 0; row < ds.row_count(); ++row )
@@ -223,6 +375,81 @@ void ut_RandomTree::testMethod_classify( void )
 
 //------------------------------------------------------------------------------
 
+void ut_RandomTree::testMethod_compile( void )
+{
+  // Create a RandomTree.
+  RandomTree tree;
+  tree.compile();
+  CPPUNIT_ASSERT_EQUAL( 0u, tree.get_compiled_node_count() );
+  double empty_row[] = { 0.0 };
+  CPPUNIT_ASSERT_EQUAL( false, tree.classify( empty_row ) );
+
+  // Add node heirarchy: [0] <= 0.5 ? ([1] <= 5.0 ? 1 : 0) : 0
+  Node *root = new SplitNode("[root]", 0, 0.5);
+  Node *branchA = new SplitNode("[0] <= 0.5", 1, 5.0);
+  branchA->add_child(new LeafNode("[1] <= 5.0", true));
+  branchA->add_child(new LeafNode("[1] > 5.0", false));
+  root->add_child(branchA);
+  root->add_child(new LeafNode("[0] > 0.5", false));
+  tree.root = root;
+  tree.compile();
+
+  // Nodes are breadth-first with adjacent children.
+  const RandomTree::CompiledNode * nodes = tree.get_compiled_nodes();
+  CPPUNIT_ASSERT_EQUAL( 5u, tree.get_compiled_node_count() );
+  CPPUNIT_ASSERT_EQUAL( 0u, nodes[0].column );
+  CPPUNIT_ASSERT_EQUAL( 1u, nodes[0].child );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, nodes[0].threshold, 1e-9 );
+  CPPUNIT_ASSERT_EQUAL( 1u, nodes[1].column );
+  CPPUNIT_ASSERT_EQUAL( 3u, nodes[1].child );
+  CPPUNIT_ASSERT_EQUAL( RandomTree::LeafColumn, nodes[2].column );
+  CPPUNIT_ASSERT_EQUAL( 0u, nodes[2].child );
+  CPPUNIT_ASSERT_EQUAL( RandomTree::LeafColumn, nodes[3].column );
+  CPPUNIT_ASSERT_EQUAL( 1u, nodes[3].child );
+  CPPUNIT_ASSERT_EQUAL( RandomTree::LeafColumn, nodes[4].column );
+  CPPUNIT_ASSERT_EQUAL( 0u, nodes[4].child );
+
+  // Classify.
+  double row_a[] = { 0.0, 5.0 };
+  double row_b[] = { 0.0, 6.0 };
+  double row_c[] = { 1.0, 0.0 };
+  CPPUNIT_ASSERT_EQUAL( true, tree.classify( row_a ) );
+  CPPUNIT_ASSERT_EQUAL( false, tree.classify( row_b ) );
+  CPPUNIT_ASSERT_EQUAL( false, tree.classify( row_c ) );
+
+  // An attached copy of the nodes classifies the same way.
+  RandomTree attached;
+  attached.attach( nodes, tree.get_compiled_node_count() );
+  CPPUNIT_ASSERT( attached.get_root() == null(Node) );
+  CPPUNIT_ASSERT( attached.get_compiled_nodes() == nodes );
+  CPPUNIT_ASSERT_EQUAL( true, attached.classify( row_a ) );
+  CPPUNIT_ASSERT_EQUAL( false, attached.classify( row_b ) );
+  CPPUNIT_ASSERT_EQUAL( false, attached.classify( row_c ) );
+
+  // Rows in compact storage vote the same way.
+  Dataset rows( 3, 2 );
+  rows[0][0] = row_a[0]; rows[0][1] = row_a[1];
+  rows[1][0] = row_b[0]; rows[1][1] = row_b[1];
+  rows[2][0] = row_c[0]; rows[2][1] = row_c[1];
+  Dataset::RealMatrix codes( rows, Dataset::CodeStorage );
+  Dataset coded( codes, 3 );
+  for ( unsigned int row = 0; row < 3; ++row )
+  {
+    coded(row) = row;
+  }
+  unsigned int votes[3] = { 0, 0, 0 };
+  tree.vote_batch( coded, 0, 3, votes );
+  CPPUNIT_ASSERT_EQUAL( 1u, votes[0] );
+  CPPUNIT_ASSERT_EQUAL( 0u, votes[1] );
+  CPPUNIT_ASSERT_EQUAL( 0u, votes[2] );
+
+  // Burning clears the compiled tree.
+  tree.burn();
+  CPPUNIT_ASSERT_EQUAL( 0u, tree.get_compiled_node_count() );
+}
+
+//------------------------------------------------------------------------------
+
 void ut_RandomTree::testMethod_classify_oob_set( void )
 {
 }
@@ -17,7 +17,9 @@ class ut_RandomTree : public CppUnit::TestFixture
     CPPUNIT_TEST( testConstructor );
     CPPUNIT_TEST( testMethod_draw );
     CPPUNIT_TEST( testMethod_grow_decision_tree );
+    CPPUNIT_TEST( testMethod_grow_decision_tree_distributed );
     CPPUNIT_TEST( testMethod_classify );
+    CPPUNIT_TEST( testMethod_compile );
     CPPUNIT_TEST( testMethod_classify_oob_set );
     //CPPUNIT_TEST( testMethod_serialize );
   CPPUNIT_TEST_SUITE_END();
@@ -26,7 +28,9 @@ class ut_RandomTree : public CppUnit::TestFixture
     void testConstructor( void );
     void testMethod_draw( void );
     void testMethod_grow_decision_tree( void );
+    void testMethod_grow_decision_tree_distributed( void );
     void testMethod_classify( void );
+    void testMethod_compile( void );
     void testMethod_classify_oob_set( void );
 };
 
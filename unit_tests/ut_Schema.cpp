@@ -0,0 +1,183 @@
+/*
+ * ut_Schema.cpp
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "ut_Schema.h"
+#include "Schema.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ut_Schema );
+
+namespace ut_Schema_ns
+{
+  const char * const Filename = "data/output/schema_test.csv";
+
+  void write_file( const char * const contents )
+  {
+    ofstream file( Filename, ios_base::out | ios_base::binary );
+    file << contents;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ut_Schema::testMethod_read_write( void )
+{
+  // Settings left out keep their values; comments and CRLFs are fine.
+  Schema schema;
+  schema.set_header( true );
+  istringstream sidecar(
+    "# Comment\r\n"
+    "\n"
+    "delimiter=,\n"
+    "id-column=none\r\n"
+    "label-column=3\n"
+    "columns=3\n"
+    "positive-max=0.5\n"
+    "name=label\n"
+    "name=first feature\n"
+    "name=second\n" );
+  CPPUNIT_ASSERT( schema.read( sidecar ) );
+  CPPUNIT_ASSERT_EQUAL( 3u, schema.column_count() );
+  CPPUNIT_ASSERT_EQUAL( 2u, schema.feature_count() );
+  CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(3), schema.get_names().size() );
+  CPPUNIT_ASSERT_EQUAL( string("first feature"), schema.get_names()[1] );
+
+  // Writing and reading back gives the same schema.
+  ostringstream schema_out;
+  schema.write( schema_out );
+  Schema copy;
+  istringstream schema_in( schema_out.str() );
+  CPPUNIT_ASSERT( copy.read( schema_in ) );
+  ostringstream copy_out;
+  copy.write( copy_out );
+  CPPUNIT_ASSERT_EQUAL( schema_out.str(), copy_out.str() );
+  CPPUNIT_ASSERT( schema_out.str().find( "positive-max=0.5\n" ) != string::npos );
+
+  // Names read again replace the old ones.
+  istringstream renamed( "name=class\n" );
+  CPPUNIT_ASSERT( copy.read( renamed ) );
+  CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(1), copy.get_names().size() );
+
+  Dataset::KeyList keys;
+  schema.name_keys( keys );
+  CPPUNIT_ASSERT_EQUAL( 0u, keys["label"] );
+  CPPUNIT_ASSERT_EQUAL( 2u, keys["second"] );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_Schema::testMethod_read_invalid( void )
+{
+  const char * const lines[] = {
+    "columns\n",
+    "columns=many\n",
+    "label-column=-1\n",
+    "delimiter=ab\n",
+    "header=2\n",
+    "positive-max=low\n",
+    "colour=blue\n" };
+  for ( unsigned int line = 0; line < sizeof(lines) / sizeof(lines[0]); ++line )
+  {
+    Schema schema;
+    istringstream sidecar( lines[line] );
+    CPPUNIT_ASSERT( !schema.read( sidecar ) );
+  }
+
+  Schema schema;
+  CPPUNIT_ASSERT( !schema.read( string("data/output/no_such_file.schema") ) );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_Schema::testMethod_infer( void )
+{
+  using namespace ut_Schema_ns;
+
+  // Names from the header, the column count from the first line.
+  write_file( "id\tclass\tdepth\tratio\n7\t1\t1.5\t0.25\n" );
+  Schema schema;
+  schema.set_id_column( 0 );
+  schema.set_label_column( 1 );
+  schema.set_header( true );
+  TextLoader loader;
+  schema.configure( loader );
+  CPPUNIT_ASSERT( loader.open( Filename ) );
+  schema.infer( loader );
+  CPPUNIT_ASSERT_EQUAL( 3u, schema.column_count() );
+  CPPUNIT_ASSERT_EQUAL( string("class"), schema.get_names()[0] );
+  CPPUNIT_ASSERT_EQUAL( string("ratio"), schema.get_names()[2] );
+
+  // A fixed column count and no header: names from the sidecar, and the
+  // rest numbered.
+  write_file( "7\t1\t1.5\t0.25\t9\n" );
+  Schema numbered;
+  istringstream sidecar(
+    "id-column=0\nlabel-column=1\ncolumns=4\nname=somatic\n" );
+  CPPUNIT_ASSERT( numbered.read( sidecar ) );
+  numbered.configure( loader );
+  CPPUNIT_ASSERT( loader.open( Filename ) );
+  numbered.infer( loader );
+  CPPUNIT_ASSERT_EQUAL( 4u, numbered.column_count() );
+  CPPUNIT_ASSERT_EQUAL( string("somatic"), numbered.get_names()[0] );
+  CPPUNIT_ASSERT_EQUAL( string("f1"), numbered.get_names()[1] );
+  CPPUNIT_ASSERT_EQUAL( string("f3"), numbered.get_names()[3] );
+
+  remove( Filename );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_Schema::testMethod_matches( void )
+{
+  using namespace ut_Schema_ns;
+  const char * const ColumnFilename = "data/output/schema_test.rfd";
+
+  // A file converted with the schema's settings matches it.
+  write_file( "7\t1\t1.5\n8\t0\t2.5\n" );
+  Schema schema;
+  schema.set_id_column( 0 );
+  schema.set_label_column( 1 );
+  TextLoader loader;
+  schema.configure( loader );
+  CPPUNIT_ASSERT( loader.open( Filename ) );
+  schema.infer( loader );
+  Dataset::KeyList keys;
+  schema.name_keys( keys );
+  CPPUNIT_ASSERT( ColumnFile::convert( loader, ColumnFilename, keys, schema.source() ) );
+  ColumnFile file;
+  CPPUNIT_ASSERT( file.open( ColumnFilename ) );
+  CPPUNIT_ASSERT( schema.matches( file ) );
+
+  // Other fields, delimiters or header settings don't.
+  Schema other_label = schema;
+  other_label.set_label_column( 2 );
+  CPPUNIT_ASSERT( !other_label.matches( file ) );
+  Schema other_id = schema;
+  other_id.set_id_column( TextLoader::NoColumn );
+  CPPUNIT_ASSERT( !other_id.matches( file ) );
+  Schema other_delimiter = schema;
+  other_delimiter.set_delimiter( ',' );
+  CPPUNIT_ASSERT( !other_delimiter.matches( file ) );
+  Schema other_header = schema;
+  other_header.set_header( true );
+  CPPUNIT_ASSERT( !other_header.matches( file ) );
+  Schema other_columns = schema;
+  other_columns.set_column_count( 3 );
+  CPPUNIT_ASSERT( !other_columns.matches( file ) );
+  Schema thresholded = schema;
+  thresholded.set_label_threshold( true, 1.0 );
+  CPPUNIT_ASSERT( !thresholded.matches( file ) );
+
+  file.close();
+  remove( ColumnFilename );
+  remove( Filename );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,27 @@
+/*
+ * ut_Schema.h
+ */
+
+#ifndef __ut_Schema_h__
+#define __ut_Schema_h__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestFixture.h>
+
+class ut_Schema : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( ut_Schema );
+    CPPUNIT_TEST( testMethod_read_write );
+    CPPUNIT_TEST( testMethod_read_invalid );
+    CPPUNIT_TEST( testMethod_infer );
+    CPPUNIT_TEST( testMethod_matches );
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testMethod_read_write( void );
+    void testMethod_read_invalid( void );
+    void testMethod_infer( void );
+    void testMethod_matches( void );
+};
+
+#endif
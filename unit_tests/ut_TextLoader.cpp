@@ -0,0 +1,287 @@
+/*
+ * ut_TextLoader.cpp
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "ut_TextLoader.h"
+#include "TextLoader.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ut_TextLoader );
+
+namespace ut_TextLoader_ns
+{
+  const char * const Filename = "data/output/text_loader_test.csv";
+
+  void write_file( const char * const contents )
+  {
+    ofstream file( Filename, ios_base::out | ios_base::binary );
+    file << contents;
+  }
+
+  double negate_label( const double value )
+  {
+    return -value;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ut_TextLoader::testMethod_open( void )
+{
+  using namespace ut_TextLoader_ns;
+
+  TextLoader loader;
+  CPPUNIT_ASSERT( !loader.open( "data/output/no_such_file.csv" ) );
+  CPPUNIT_ASSERT_EQUAL( 0u, loader.column_count() );
+
+  // A trailing delimiter doesn't count as a field.
+  write_file( "7\t1\t2.5\t\n8\t0\t3\t\n" );
+  CPPUNIT_ASSERT( loader.open( Filename ) );
+  CPPUNIT_ASSERT_EQUAL( 3u, loader.column_count() );
+  loader.set_id_column( 0 );
+  CPPUNIT_ASSERT_EQUAL( 2u, loader.column_count() );
+  CPPUNIT_ASSERT_EQUAL( 2ul, loader.count_rows() );
+
+  // An empty file has no rows.
+  write_file( "" );
+  CPPUNIT_ASSERT( loader.open( Filename ) );
+  CPPUNIT_ASSERT_EQUAL( 0ul, loader.count_rows() );
+  double row[1];
+  CPPUNIT_ASSERT( !loader.next_row( row ) );
+
+  remove( Filename );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_TextLoader::testMethod_next_row( void )
+{
+  using namespace ut_TextLoader_ns;
+
+  // ID, feature, label, feature; CRLF line ends, a blank line, a short line
+  // and no newline at the end.
+  write_file( "a,1.5,3,-2e-1\r\n\nb,+4, 2,\nc,7,1" );
+  TextLoader loader;
+  loader.set_delimiter( ',' );
+  loader.set_id_column( 0 );
+  loader.set_label_column( 2 );
+  loader.set_label_function( negate_label );
+  CPPUNIT_ASSERT( loader.open( Filename ) );
+  CPPUNIT_ASSERT_EQUAL( 3u, loader.column_count() );
+  CPPUNIT_ASSERT_EQUAL( 3ul, loader.count_rows() );
+
+  double row[3];
+  CPPUNIT_ASSERT( loader.next_row( row ) );
+  CPPUNIT_ASSERT_EQUAL( -3.0, row[0] );
+  CPPUNIT_ASSERT_EQUAL( 1.5, row[1] );
+  CPPUNIT_ASSERT_EQUAL( -0.2, row[2] );
+
+  CPPUNIT_ASSERT( loader.skip_row() );
+
+  CPPUNIT_ASSERT( loader.next_row( row ) );
+  CPPUNIT_ASSERT_EQUAL( -1.0, row[0] );
+  CPPUNIT_ASSERT_EQUAL( 7.0, row[1] );
+  CPPUNIT_ASSERT_EQUAL( 0.0, row[2] );
+  CPPUNIT_ASSERT( !loader.next_row( row ) );
+
+  // Rewinding starts over; leading blanks and plus signs are accepted.
+  loader.rewind();
+  CPPUNIT_ASSERT( loader.skip_row() );
+  CPPUNIT_ASSERT( loader.next_row( row ) );
+  CPPUNIT_ASSERT_EQUAL( -2.0, row[0] );
+  CPPUNIT_ASSERT_EQUAL( 4.0, row[1] );
+  CPPUNIT_ASSERT_EQUAL( 0.0, row[2] );
+
+  remove( Filename );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_TextLoader::testMethod_read( void )
+{
+  using namespace ut_TextLoader_ns;
+
+  write_file( "1\t0.1\t10\n0\t0.2\t20\n1\t0.3\t30\n" );
+  TextLoader loader;
+  CPPUNIT_ASSERT( loader.open( Filename ) );
+
+  // Both layouts get the same values, up to the matrix size.
+  Dataset::RealMatrix row_major( 2, loader.column_count(), Dataset::RowMajor );
+  CPPUNIT_ASSERT_EQUAL( 2ul, loader.read( row_major ) );
+  Dataset::RealMatrix column_major( 4, loader.column_count(), Dataset::ColumnMajor );
+  loader.rewind();
+  CPPUNIT_ASSERT_EQUAL( 3ul, loader.read( column_major ) );
+  for ( unsigned int row = 0; row < 2; ++row )
+  {
+    for ( unsigned int column = 0; column < 3; ++column )
+    {
+      CPPUNIT_ASSERT_EQUAL( row_major.at(row, column), column_major.at(row, column) );
+    }
+  }
+  CPPUNIT_ASSERT_EQUAL( 0.0, row_major.at(1, 0) );
+  CPPUNIT_ASSERT_EQUAL( 0.2, row_major.at(1, 1) );
+  CPPUNIT_ASSERT_EQUAL( 30.0, column_major.at(2, 2) );
+
+  // Thresholded labels are 1 up to positive_max and 0 above it.
+  loader.set_label_threshold( true, 0.5 );
+  loader.rewind();
+  CPPUNIT_ASSERT_EQUAL( 3ul, loader.read( column_major ) );
+  CPPUNIT_ASSERT_EQUAL( 0.0, column_major.at(0, 0) );
+  CPPUNIT_ASSERT_EQUAL( 1.0, column_major.at(1, 0) );
+
+  remove( Filename );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_TextLoader::testMethod_read_parallel( void )
+{
+  using namespace ut_TextLoader_ns;
+
+  // Enough text for several chunks, with blank lines and lines of varying
+  // length.
+  const unsigned int rows = 20000;
+  stringstream text;
+  for ( unsigned int row = 0; row < rows; ++row )
+  {
+    text << row << '\t' << (row % 2) << '\t' << row * 0.25 << '\t' << (row % 7) << "\n";
+    if ( row % 1000 == 0 )
+    {
+      text << "\n";
+    }
+  }
+  write_file( text.str().c_str() );
+
+  TextLoader serial;
+  serial.set_id_column( 0 );
+  CPPUNIT_ASSERT( serial.open( Filename ) );
+  Dataset::RealMatrix expected( rows, serial.column_count() );
+  CPPUNIT_ASSERT_EQUAL( static_cast<unsigned long>(rows), serial.read( expected ) );
+
+  TextLoader loader;
+  loader.set_id_column( 0 );
+  loader.set_thread_count( 4 );
+  CPPUNIT_ASSERT( loader.open( Filename ) );
+  CPPUNIT_ASSERT_EQUAL( static_cast<unsigned long>(rows), loader.count_rows() );
+
+  // The whole file at once, in either layout.
+  Dataset::Layout layouts[] = { Dataset::RowMajor, Dataset::ColumnMajor };
+  for ( unsigned int layout = 0; layout < 2; ++layout )
+  {
+    loader.rewind();
+    Dataset::RealMatrix matrix( rows + 5, 3, layouts[layout] );
+    CPPUNIT_ASSERT_EQUAL( static_cast<unsigned long>(rows), loader.read( matrix ) );
+    for ( unsigned int row = 0; row < rows; ++row )
+    {
+      for ( unsigned int column = 0; column < 3; ++column )
+      {
+        CPPUNIT_ASSERT_EQUAL( expected.at(row, column), matrix.at(row, column) );
+      }
+    }
+  }
+
+  // Blocks pick up where the last one stopped, and rows can be read between
+  // them.
+  loader.rewind();
+  Dataset::RealMatrix block( 3001, 3 );
+  unsigned int row = 0;
+  unsigned long block_rows = 0;
+  while ( (block_rows = loader.read( block )) > 0 )
+  {
+    for ( unsigned int block_row = 0; block_row < block_rows; ++block_row, ++row )
+    {
+      CPPUNIT_ASSERT_EQUAL( expected.at(row, 1), block.at(block_row, 1) );
+    }
+    double values[3];
+    if ( loader.next_row( values ) )
+    {
+      CPPUNIT_ASSERT_EQUAL( expected.at(row, 1), values[1] );
+      ++row;
+    }
+  }
+  CPPUNIT_ASSERT_EQUAL( rows, row );
+
+  // Selected rows: two in three, in blocks that run past the end.
+  loader.rewind();
+  vector<bool> keep( 15000 );
+  for ( unsigned int line = 0; line < keep.size(); ++line )
+  {
+    keep[line] = ( line % 3 != 0 );
+  }
+  Dataset::RealMatrix selected( keep.size(), 3 );
+  row = 0;
+  unsigned long passed = 0;
+  do
+  {
+    passed = loader.read_selected( selected, keep );
+    for ( unsigned int line = 0, kept = 0; line < passed; ++line, ++row )
+    {
+      if ( keep[line] )
+      {
+        CPPUNIT_ASSERT_EQUAL( expected.at(row, 2), selected.at(kept++, 2) );
+      }
+    }
+  }
+  while ( passed == keep.size() );
+  CPPUNIT_ASSERT_EQUAL( rows, row );
+
+  remove( Filename );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_TextLoader::testMethod_header( void )
+{
+  using namespace ut_TextLoader_ns;
+
+  write_file( "id,depth,label,ratio\n7,1.5,1,0.25\n8,2.5,0,0.5\n" );
+  TextLoader loader;
+  loader.set_delimiter( ',' );
+  loader.set_id_column( 0 );
+  loader.set_label_column( 2 );
+  loader.set_header( true );
+  CPPUNIT_ASSERT( loader.open( Filename ) );
+  CPPUNIT_ASSERT_EQUAL( 3u, loader.column_count() );
+  CPPUNIT_ASSERT_EQUAL( 2ul, loader.count_rows() );
+
+  // The label comes first and the ID is left out.
+  vector<string> names;
+  loader.column_names( names );
+  CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(3), names.size() );
+  CPPUNIT_ASSERT_EQUAL( string("label"), names[0] );
+  CPPUNIT_ASSERT_EQUAL( string("depth"), names[1] );
+  CPPUNIT_ASSERT_EQUAL( string("ratio"), names[2] );
+
+  // The header isn't a row, before or after rewinding.
+  double row[3];
+  CPPUNIT_ASSERT( loader.next_row( row ) );
+  CPPUNIT_ASSERT_EQUAL( 1.0, row[0] );
+  CPPUNIT_ASSERT_EQUAL( 1.5, row[1] );
+  loader.rewind();
+  Dataset::RealMatrix matrix( 3, 3 );
+  CPPUNIT_ASSERT_EQUAL( 2ul, loader.read( matrix ) );
+  CPPUNIT_ASSERT_EQUAL( 0.5, matrix.at(1, 2) );
+
+  // A column past the header is unnamed.
+  loader.set_column_count( 4 );
+  loader.column_names( names );
+  CPPUNIT_ASSERT_EQUAL( static_cast<size_t>(4), names.size() );
+  CPPUNIT_ASSERT( names[3].empty() );
+
+  // Without a header there are no names.
+  loader.set_header( false );
+  CPPUNIT_ASSERT( loader.open( Filename ) );
+  loader.column_names( names );
+  CPPUNIT_ASSERT( names.empty() );
+  CPPUNIT_ASSERT_EQUAL( 3ul, loader.count_rows() );
+
+  remove( Filename );
+}
+
+//------------------------------------------------------------------------------
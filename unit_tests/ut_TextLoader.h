@@ -0,0 +1,29 @@
+/*
+ * ut_TextLoader.h
+ */
+
+#ifndef __ut_TextLoader_h__
+#define __ut_TextLoader_h__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestFixture.h>
+
+class ut_TextLoader : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( ut_TextLoader );
+    CPPUNIT_TEST( testMethod_open );
+    CPPUNIT_TEST( testMethod_next_row );
+    CPPUNIT_TEST( testMethod_read );
+    CPPUNIT_TEST( testMethod_read_parallel );
+    CPPUNIT_TEST( testMethod_header );
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testMethod_open( void );
+    void testMethod_next_row( void );
+    void testMethod_read( void );
+    void testMethod_read_parallel( void );
+    void testMethod_header( void );
+};
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * ut_ThreadPool.cpp
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "ut_ThreadPool.h"
+#include "ThreadPool.h"
+
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ut_ThreadPool );
+
+namespace ut_ThreadPool_ns
+{
+  /**
+   * Counts how often each index runs. The first few indices take longer, so
+   * the other threads have to steal them.
+   */
+  class CountingTask : public ThreadPool::Task
+  {
+    public:
+      CountingTask( const unsigned int task_count ) :
+        runs( task_count, 0 )
+      {
+        pthread_mutex_init(&mutex, NULL);
+      }
+
+      ~CountingTask( void )
+      {
+        pthread_mutex_destroy(&mutex);
+      }
+
+      virtual void run( const unsigned int index )
+      {
+        if ( index < 4 )
+        {
+          usleep( 20000 );
+        }
+        pthread_mutex_lock(&mutex);
+        ++runs[index];
+        pthread_mutex_unlock(&mutex);
+      }
+
+      pthread_mutex_t mutex;
+      vector<unsigned int> runs;
+  };
+}
+
+//------------------------------------------------------------------------------
+
+void ut_ThreadPool::testConstructor( void )
+{
+  ThreadPool pool( 3 );
+  CPPUNIT_ASSERT_EQUAL( 3u, pool.get_thread_count() );
+
+  ThreadPool hardware_pool( 0 );
+  CPPUNIT_ASSERT_EQUAL(
+    ThreadPool::hardware_concurrency(), hardware_pool.get_thread_count() );
+  CPPUNIT_ASSERT( ThreadPool::hardware_concurrency() >= 1u );
+}
+
+//------------------------------------------------------------------------------
+
+void ut_ThreadPool::testMethod_run( void )
+{
+  for ( unsigned int threads = 1; threads <= 8; threads *= 2 )
+  {
+    for ( unsigned int task_count = 0; task_count < 40; task_count += 13 )
+    {
+      // Every index runs exactly once.
+      ut_ThreadPool_ns::CountingTask task( task_count );
+      ThreadPool pool( threads );
+      pool.run( task, task_count );
+      for ( unsigned int index = 0; index < task_count; ++index )
+      {
+        CPPUNIT_ASSERT_EQUAL( 1u, task.runs[index] );
+      }
+
+      // The pool can be reused.
+      pool.start( task, task_count );
+      pool.join();
+      for ( unsigned int index = 0; index < task_count; ++index )
+      {
+        CPPUNIT_ASSERT_EQUAL( 2u, task.runs[index] );
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,23 @@
+/*
+ * ut_ThreadPool.h
+ */
+
+#ifndef __ut_ThreadPool_h__
+#define __ut_ThreadPool_h__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestFixture.h>
+
+class ut_ThreadPool : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( ut_ThreadPool );
+    CPPUNIT_TEST( testConstructor );
+    CPPUNIT_TEST( testMethod_run );
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testConstructor( void );
+    void testMethod_run( void );
+};
+
+#endif